@@ -23,6 +23,24 @@ void bit_set_pop_front(bit_set_t *);
 void bit_set_set(bit_set_t *, long long, bit_t);
 [[ nodiscard ]] bit_t bit_set_get(const bit_set_t *, long long);
 void bit_set_reverse(bit_set_t *);
+// bitwise set algebra, the shorter operand reads as zero extended and the result takes the longer size
+void bit_set_and(bit_set_t *, const bit_set_t *);
+void bit_set_or(bit_set_t *, const bit_set_t *);
+void bit_set_xor(bit_set_t *, const bit_set_t *);
+void bit_set_andnot(bit_set_t *, const bit_set_t *);
+void bit_set_not(bit_set_t *);
+// out of place variants store into the first set, which may be one of the operands
+void bit_set_and_to(bit_set_t *, const bit_set_t *, const bit_set_t *);
+void bit_set_or_to(bit_set_t *, const bit_set_t *, const bit_set_t *);
+void bit_set_xor_to(bit_set_t *, const bit_set_t *, const bit_set_t *);
+void bit_set_andnot_to(bit_set_t *, const bit_set_t *, const bit_set_t *);
+void bit_set_not_to(bit_set_t *, const bit_set_t *);
+// rank and select build their index on the first query after a mutation, then answer from it
+[[ nodiscard ]] size_t bit_set_count(const bit_set_t *);
+// ones before the index, an index past the size counts the whole set
+[[ nodiscard ]] size_t bit_set_rank(bit_set_t *, size_t);
+// position of the one with the given zero based rank, the size when there are not that many ones
+[[ nodiscard ]] size_t bit_set_select(bit_set_t *, size_t);
 void bit_set_delete(bit_set_t *);
 void bit_set_print(const bit_set_t *);
 
@@ -0,0 +1,36 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "containers.h"
+#include "hash_map.h"
+
+typedef enum : unsigned char {
+    CACHE_ENTRIES = 0,
+    CACHE_BYTES = 1
+} cache_unit_t;
+
+typedef enum : unsigned char {
+    CACHE_LRU = 0,
+    CACHE_TINY_LFU = 1 // W-TinyLFU admission
+} cache_policy_t;
+
+struct cache;
+struct cache_stats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+};
+
+typedef struct cache cache_t;
+typedef struct cache_stats cache_stats_t;
+typedef void (*evict_t)(const node_data_t *, const node_data_t *);
+
+[[ nodiscard ]] cache_t *cache_init(size_t, cache_unit_t, cache_policy_t, hash_t, comparator_t, evict_t);
+[[ nodiscard ]] size_t cache_size(const cache_t *);
+void cache_insert(cache_t *, size_t, const void *, size_t, const void *);
+void cache_remove(cache_t *, size_t, const void *);
+[[ nodiscard ]] node_data_t *cache_at(cache_t *, size_t, const void *);
+[[ nodiscard ]] cache_stats_t cache_stats(const cache_t *);
+void cache_delete(cache_t *);
+
+#endif // CACHE_H
@@ -3,14 +3,20 @@
 
 #include "containers.h"
 
+#define HASH_MAP_LOAD_FACTOR_MAX 0.75l
+#define HASH_MAP_LOAD_FACTOR_MIN 0.25l
+#define HASH_MAP_MOD(capacity) ((capacity) * 86ul / 100ul) // address region, the rest is the cellar
+
 struct pair;
 struct bucket;
 struct hash_map;
+struct hash_map_mmap;
 
 typedef struct pair pair_t;
 typedef struct bucket bucket_t;
 typedef size_t (*hash_t)(size_t, size_t, const void *);
 typedef struct hash_map hash_map_t;
+typedef struct hash_map_mmap hash_map_mmap_t;
 
 [[ nodiscard ]] hash_map_t *hash_map_init(size_t, hash_t, comparator_t);
 [[ nodiscard ]] size_t hash_map_size(const hash_map_t *);
@@ -20,6 +26,13 @@ void hash_map_remove(hash_map_t *, size_t, const void *, unsigned char);
 void hash_map_delete(hash_map_t *, unsigned char);
 void hash_map_print(const hash_map_t *, print_t, print_t);
 
+// snapshot image
+unsigned char hash_map_save(const hash_map_t *, const char *);
+[[ nodiscard ]] hash_map_mmap_t *hash_map_open_mmap(const char *, hash_t, comparator_t);
+[[ nodiscard ]] size_t hash_map_mmap_size(const hash_map_mmap_t *);
+[[ nodiscard ]] node_data_t hash_map_mmap_at(const hash_map_mmap_t *, size_t, const void *);
+void hash_map_mmap_close(hash_map_mmap_t *);
+
 // hash functions
 [[ nodiscard ]] size_t hash_any(size_t, size_t, const void *);
 [[ nodiscard ]] size_t hash_ul(size_t, size_t, const void *);
@@ -0,0 +1,97 @@
+#ifndef HASH_MAP_CHAIN_H
+#define HASH_MAP_CHAIN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HASH_MAP_CHAIN_STACK_CAPACITY 16ul
+
+// coalesced hashing over bucket indices, shared by every hash container:
+// buckets link through size_t next, bucket index + 1 and 0 for chain end,
+// the table keeps size_t free_cursor, the free bucket lookup position moving towards the beginning,
+// and the container defines before expanding
+//     bucket_t *prefix##_bucket(const table_t *, size_t index)
+//     size_t prefix##_capacity(const table_t *)
+//     unsigned char prefix##_occupied(const bucket_t *)
+//     size_t prefix##_home(const table_t *, const bucket_t *) -> address region index of the held entry
+//     void prefix##_clear(bucket_t *) -> empties the entry, next is handled here
+#define HASH_MAP_CHAIN_DEFINE(prefix, table_t, bucket_t)                                                \
+[[ nodiscard ]] static inline size_t prefix##_free_bucket(table_t *const this) {                        \
+    const size_t capacity = prefix##_capacity(this);                                                    \
+    /* second pass picks up buckets freed behind the cursor */                                          \
+    for (unsigned char pass = 0; pass < 2; ++pass) {                                                    \
+        while (this->free_cursor > 0ul) {                                                               \
+            const size_t index = --this->free_cursor;                                                   \
+            if (!prefix##_occupied(prefix##_bucket(this, index))) {                                     \
+                return index;                                                                           \
+            }                                                                                           \
+        }                                                                                               \
+        this->free_cursor = capacity;                                                                   \
+    }                                                                                                   \
+    return capacity;                                                                                    \
+}                                                                                                       \
+                                                                                                        \
+/* bucket for a new entry homed at home, appended to its chain, NULL when the table is full */          \
+[[ nodiscard ]] static inline bucket_t *prefix##_link(table_t *const this, const size_t home) {         \
+    bucket_t *b = prefix##_bucket(this, home);                                                          \
+    if (prefix##_occupied(b)) { /* collision */                                                         \
+        while (b->next != 0ul) {                                                                        \
+            b = prefix##_bucket(this, b->next - 1ul);                                                   \
+        }                                                                                               \
+        const size_t free_index = prefix##_free_bucket(this);                                           \
+        if (free_index == prefix##_capacity(this)) {                                                    \
+            return NULL;                                                                                \
+        }                                                                                               \
+        b->next = free_index + 1ul;                                                                     \
+        b = prefix##_bucket(this, free_index);                                                          \
+    }                                                                                                   \
+    b->next = 0ul;                                                                                      \
+    return b;                                                                                           \
+}                                                                                                       \
+                                                                                                        \
+/* empties b, prev precedes it in its chain or is NULL, 0 when nothing changed */                       \
+[[ nodiscard ]] static inline unsigned char prefix##_unlink(                                            \
+    table_t *const this,                                                                                \
+    bucket_t *const prev,                                                                               \
+    bucket_t *const b                                                                                   \
+) {                                                                                                     \
+    /* coalesced chains cannot be relinked around the gap, the chain tail is placed again */            \
+    size_t chain_size = 0ul;                                                                            \
+    for (size_t c = b->next; c != 0ul; c = prefix##_bucket(this, c - 1ul)->next) {                      \
+        ++chain_size;                                                                                   \
+    }                                                                                                   \
+    bucket_t chain_stack_buffer[HASH_MAP_CHAIN_STACK_CAPACITY];                                         \
+    bucket_t *chain = chain_stack_buffer;                                                               \
+    if (chain_size > HASH_MAP_CHAIN_STACK_CAPACITY) {                                                   \
+        chain = malloc(chain_size * sizeof(bucket_t));                                                  \
+        if (chain == NULL) {                                                                            \
+            fprintf(stderr, "malloc NULL return in " #prefix "_unlink for chain size %lu\n", chain_size); \
+            return 0;                                                                                   \
+        }                                                                                               \
+    }                                                                                                   \
+    if (prev != NULL) {                                                                                 \
+        prev->next = 0ul;                                                                               \
+    }                                                                                                   \
+    size_t c = b->next;                                                                                 \
+    prefix##_clear(b);                                                                                  \
+    b->next = 0ul;                                                                                      \
+    for (size_t i = 0ul; i < chain_size; ++i) {                                                         \
+        bucket_t *const chained = prefix##_bucket(this, c - 1ul);                                       \
+        c = chained->next;                                                                              \
+        chain[i] = *chained;                                                                            \
+        prefix##_clear(chained);                                                                        \
+        chained->next = 0ul;                                                                            \
+    }                                                                                                   \
+    for (size_t i = 0ul; i < chain_size; ++i) {                                                         \
+        /* the emptied buckets leave room for every entry */                                            \
+        bucket_t *const placed = prefix##_link(this, prefix##_home(this, chain + i));                   \
+        *placed = chain[i];                                                                             \
+        placed->next = 0ul;                                                                             \
+    }                                                                                                   \
+    if (chain != chain_stack_buffer) {                                                                  \
+        free(chain);                                                                                    \
+    }                                                                                                   \
+    return 1;                                                                                           \
+}
+
+#endif // HASH_MAP_CHAIN_H
@@ -0,0 +1,206 @@
+#ifndef HASH_MAP_TYPED_H
+#define HASH_MAP_TYPED_H
+
+#include "hash_map.h"
+#include "hash_map_chain.h"
+#include <stdio.h>
+
+#define HASH_MAP_TYPED_MIN_CAPACITY 2ul
+
+// reduces a well mixed hash to [0, m)
+[[ nodiscard ]] static inline size_t hash_map_reduce(const size_t hash, const size_t m) {
+#ifdef __SIZEOF_INT128__
+    return (size_t)(((unsigned __int128)hash * m) >> 64);
+#else
+    return hash % m;
+#endif
+}
+
+[[ nodiscard ]] static inline size_t hash_map_mix(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return (size_t)x;
+}
+
+// coalesced hashing over keys and data stored by value:
+// hash_function(K) -> size_t, key_equal(K, K) -> non zero if equal, unlike a comparator_t
+#define HASH_MAP_DEFINE(name, K, V, hash_function, key_equal)                                           \
+typedef struct name##_bucket name##_bucket_t;                                                           \
+typedef struct name name##_t;                                                                           \
+                                                                                                        \
+struct name##_bucket {                                                                                  \
+    K key;                                                                                              \
+    V data;                                                                                             \
+    size_t next; /* bucket index + 1, 0 for chain end */                                                \
+    unsigned char occupied;                                                                             \
+};                                                                                                      \
+                                                                                                        \
+struct name {                                                                                           \
+    name##_bucket_t *buffer;                                                                            \
+    size_t capacity;                                                                                    \
+    size_t address_capacity;                                                                            \
+    size_t size;                                                                                        \
+    size_t max_size;                                                                                    \
+    size_t min_size;                                                                                    \
+    size_t free_cursor; /* free bucket lookup position, moves towards the beginning */                  \
+};                                                                                                      \
+                                                                                                        \
+[[ nodiscard ]] static inline unsigned char name##_reserve(name##_t *const this, size_t capacity) {     \
+    if (capacity < HASH_MAP_TYPED_MIN_CAPACITY) {                                                       \
+        capacity = HASH_MAP_TYPED_MIN_CAPACITY;                                                         \
+    }                                                                                                   \
+    name##_bucket_t *const buffer = calloc(capacity, sizeof(name##_bucket_t));                          \
+    if (buffer == NULL) {                                                                               \
+        fprintf(stderr, "malloc NULL return in " #name "_reserve for capacity %lu\n", capacity);        \
+        return 0;                                                                                       \
+    }                                                                                                   \
+    this->buffer = buffer;                                                                              \
+    this->capacity = capacity;                                                                          \
+    this->address_capacity = HASH_MAP_MOD(capacity);                                                    \
+    this->size = 0ul;                                                                                   \
+    this->max_size = (size_t)((long double)capacity * HASH_MAP_LOAD_FACTOR_MAX);                        \
+    this->min_size = (size_t)((long double)capacity * HASH_MAP_LOAD_FACTOR_MIN);                        \
+    this->free_cursor = capacity;                                                                       \
+    return 1;                                                                                           \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline name##_t *name##_init(const size_t capacity) {                            \
+    name##_t *const hm = malloc(sizeof(name##_t));                                                      \
+    if (hm == NULL) {                                                                                   \
+        fprintf(stderr, "malloc NULL return in " #name "_init\n");                                      \
+        return hm;                                                                                      \
+    }                                                                                                   \
+    if (!name##_reserve(hm, capacity)) {                                                                \
+        free(hm);                                                                                       \
+        return NULL;                                                                                    \
+    }                                                                                                   \
+    return hm;                                                                                          \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline size_t name##_size(const name##_t *const this) {                          \
+    return this == NULL ? 0ul : this->size;                                                             \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline name##_bucket_t *name##_bucket(const name##_t *const this, const size_t index) { \
+    return this->buffer + index;                                                                        \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline size_t name##_capacity(const name##_t *const this) {                      \
+    return this->capacity;                                                                              \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline unsigned char name##_occupied(const name##_bucket_t *const b) {           \
+    return b->occupied;                                                                                 \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline size_t name##_home(const name##_t *const this, const name##_bucket_t *const b) { \
+    return hash_map_reduce(hash_function(b->key), this->address_capacity);                              \
+}                                                                                                       \
+                                                                                                        \
+static inline void name##_clear(name##_bucket_t *const b) {                                             \
+    b->occupied = 0;                                                                                    \
+}                                                                                                       \
+                                                                                                        \
+HASH_MAP_CHAIN_DEFINE(name, name##_t, name##_bucket_t)                                                  \
+                                                                                                        \
+static inline void name##_place(name##_t *const this, K const key, V const data) {                      \
+    /* key is known to be absent */                                                                     \
+    name##_bucket_t *const b = name##_link(this, hash_map_reduce(hash_function(key), this->address_capacity)); \
+    if (b == NULL) {                                                                                    \
+        return;                                                                                         \
+    }                                                                                                   \
+    b->key = key;                                                                                       \
+    b->data = data;                                                                                     \
+    b->occupied = 1;                                                                                    \
+    ++this->size;                                                                                       \
+}                                                                                                       \
+                                                                                                        \
+static inline void name##_rehash(name##_t *const this, const size_t capacity) {                         \
+    name##_t rehashed;                                                                                  \
+    if (!name##_reserve(&rehashed, capacity)) {                                                         \
+        return;                                                                                         \
+    }                                                                                                   \
+    for (size_t i = 0ul; i < this->capacity; ++i) {                                                     \
+        const name##_bucket_t *const b = this->buffer + i;                                              \
+        if (b->occupied) {                                                                              \
+            name##_place(&rehashed, b->key, b->data);                                                   \
+        }                                                                                               \
+    }                                                                                                   \
+    free(this->buffer);                                                                                 \
+    *this = rehashed;                                                                                   \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline V *name##_at(const name##_t *const this, K const key) {                   \
+    const name##_bucket_t *b = this->buffer + hash_map_reduce(hash_function(key), this->address_capacity); \
+    if (!b->occupied) {                                                                                 \
+        return NULL;                                                                                    \
+    }                                                                                                   \
+    for (;;) {                                                                                          \
+        if (key_equal(key, b->key)) {                                                                   \
+            return (V*)&b->data;                                                                        \
+        }                                                                                               \
+        if (b->next == 0ul) {                                                                           \
+            return NULL;                                                                                \
+        }                                                                                               \
+        b = this->buffer + b->next - 1ul;                                                               \
+    }                                                                                                   \
+}                                                                                                       \
+                                                                                                        \
+static inline void name##_insert(name##_t *const this, K const key, V const data) {                     \
+    V *const present = name##_at(this, key);                                                            \
+    if (present != NULL) { /* reassignment */                                                           \
+        *present = data;                                                                                \
+        return;                                                                                         \
+    }                                                                                                   \
+    if (this->size + 1ul > this->max_size) {                                                            \
+        name##_rehash(this, (this->capacity + 1ul) << 1);                                               \
+        if (this->size == this->capacity) {                                                             \
+            return;                                                                                     \
+        }                                                                                               \
+    }                                                                                                   \
+    name##_place(this, key, data);                                                                      \
+}                                                                                                       \
+                                                                                                        \
+static inline void name##_remove(name##_t *const this, K const key) {                                   \
+    name##_bucket_t *b = this->buffer + hash_map_reduce(hash_function(key), this->address_capacity);    \
+    if (!b->occupied) {                                                                                 \
+        return;                                                                                         \
+    }                                                                                                   \
+    name##_bucket_t *prev_bucket = NULL;                                                                \
+    while (!key_equal(key, b->key)) {                                                                   \
+        if (b->next == 0ul) {                                                                           \
+            return;                                                                                     \
+        }                                                                                               \
+        prev_bucket = b;                                                                                \
+        b = this->buffer + b->next - 1ul;                                                               \
+    }                                                                                                   \
+    if (!name##_unlink(this, prev_bucket, b)) {                                                         \
+        return;                                                                                         \
+    }                                                                                                   \
+    --this->size;                                                                                       \
+    if (this->size < this->min_size && this->capacity > HASH_MAP_TYPED_MIN_CAPACITY) {                  \
+        name##_rehash(this, this->capacity >> 1);                                                       \
+    }                                                                                                   \
+}                                                                                                       \
+                                                                                                        \
+[[ nodiscard ]] static inline name##_bucket_t *name##_iterate(const name##_t *const this, size_t *const cursor) { \
+    while (*cursor < this->capacity) {                                                                  \
+        name##_bucket_t *const b = this->buffer + (*cursor)++;                                          \
+        if (b->occupied) {                                                                              \
+            return b;                                                                                   \
+        }                                                                                               \
+    }                                                                                                   \
+    return NULL;                                                                                        \
+}                                                                                                       \
+                                                                                                        \
+static inline void name##_delete(name##_t *const this) {                                                \
+    if (this != NULL) {                                                                                 \
+        free(this->buffer);                                                                             \
+        free(this);                                                                                     \
+    }                                                                                                   \
+}
+
+#endif // HASH_MAP_TYPED_H
@@ -0,0 +1,23 @@
+#ifndef HASH_MULTIMAP_H
+#define HASH_MULTIMAP_H
+
+#include "containers.h"
+#include "hash_map.h"
+
+struct group_bucket;
+struct hash_multimap;
+
+typedef struct group_bucket group_bucket_t;
+typedef struct hash_multimap hash_multimap_t;
+
+[[ nodiscard ]] hash_multimap_t *hash_multimap_init(size_t, hash_t, comparator_t);
+[[ nodiscard ]] size_t hash_multimap_size(const hash_multimap_t *);
+void hash_multimap_insert(hash_multimap_t *, size_t, const void *, size_t, const void *, unsigned char);
+void hash_multimap_remove(hash_multimap_t *, size_t, const void *, unsigned char);
+void hash_multimap_remove_at(hash_multimap_t *, size_t, const void *, size_t, unsigned char);
+[[ nodiscard ]] size_t hash_multimap_count(const hash_multimap_t *, size_t, const void *);
+[[ nodiscard ]] node_data_t *hash_multimap_equal_range(const hash_multimap_t *, size_t, const void *, size_t *);
+void hash_multimap_delete(hash_multimap_t *, unsigned char);
+void hash_multimap_print(const hash_multimap_t *, print_t, print_t);
+
+#endif // HASH_MULTIMAP_H
@@ -0,0 +1,25 @@
+#ifndef HASH_SET_H
+#define HASH_SET_H
+
+#include "containers.h"
+#include "hash_map.h"
+
+struct key_bucket;
+struct hash_set;
+
+typedef struct key_bucket key_bucket_t;
+typedef struct hash_set hash_set_t;
+
+[[ nodiscard ]] hash_set_t *hash_set_init(size_t, hash_t, comparator_t);
+[[ nodiscard ]] size_t hash_set_size(const hash_set_t *);
+void hash_set_insert(hash_set_t *, size_t, const void *, unsigned char);
+void hash_set_remove(hash_set_t *, size_t, const void *, unsigned char);
+[[ nodiscard ]] unsigned char hash_set_contains(const hash_set_t *, size_t, const void *);
+[[ nodiscard ]] node_data_t *hash_set_iterate(const hash_set_t *, size_t *);
+void hash_set_union(hash_set_t *, const hash_set_t *, unsigned char);
+void hash_set_intersection(hash_set_t *, const hash_set_t *, unsigned char);
+void hash_set_difference(hash_set_t *, const hash_set_t *, unsigned char);
+void hash_set_delete(hash_set_t *, unsigned char);
+void hash_set_print(const hash_set_t *, print_t);
+
+#endif // HASH_SET_H
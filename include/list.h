@@ -22,6 +22,9 @@ void list_pop_back(list_t *, unsigned char);
 void list_pop_front(list_t *, unsigned char);
 [[ nodiscard ]] node_data_t *list_at(const list_t *, long long);
 void list_node_move_to_head(list_t *, list_node_t *);
+void list_node_move_to_tail(list_t *, list_node_t *);
+void list_node_remove(list_t *, list_node_t *, unsigned char);
+void list_node_transfer(list_t *, list_node_t *, list_t *);
 void list_swap(list_t *, list_node_t *, list_node_t *);
 void list_reverse(list_t *);
 void list_delete(list_t *, unsigned char);
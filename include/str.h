@@ -5,17 +5,88 @@
 
 struct string_control_block;
 typedef struct string_control_block string_control_block_t;
+struct string_builder_chunk;
+typedef struct string_builder_chunk string_builder_chunk_t;
+struct string_arena;
+typedef struct string_arena string_arena_t;
+struct string_arena_chunk;
+typedef struct string_arena_chunk string_arena_chunk_t;
 
+// sets the string_t layout, so it is only set through the CONTAINERS_STRING_SSO_CAPACITY CMake option,
+// which defines it for the library and everything linking it alike
+#ifndef STRING_SSO_CAPACITY
+#define STRING_SSO_CAPACITY (sizeof(size_t) * 3) // 32 byte string_t, 16 for 24 byte one, including NUL
+#endif
+
+// STRING_ATOMIC_REF_COUNTER makes copies safe to use and delete from other threads,
+// a single string_t value is still not meant to be mutated concurrently
 struct string {
     size_t size;
     union { // Small String Optimization
-        string_control_block_t *control_block; // Copy On Write
-        char buffer[sizeof(string_control_block_t *)];
+        struct { // Copy On Write
+            string_control_block_t *control_block;
+            size_t offset; // substrings share the control block
+        };
+        char buffer[STRING_SSO_CAPACITY];
     };
 };
 typedef struct string string_t;
 
+// non owning, valid while the viewed characters are not modified or freed
+struct string_view {
+    const char *data;
+    size_t size;
+};
+typedef struct string_view string_view_t;
+
+struct string_span {
+    size_t offset;
+    size_t size;
+};
+typedef struct string_span string_span_t;
+
+#define STRING_TOKENIZER_LIST_CAPACITY 8
+
+// splits a view on any of the delimiter bytes, empty tokens are skipped
+struct string_tokenizer {
+    string_view_t view;
+    size_t position;
+    size_t block; // start of the 64 bytes classified in bits
+    unsigned long long bits; // delimiter bit per block byte
+    unsigned char delimiters[256]; // byte class table
+    unsigned char low_nibbles[16]; // ASCII delimiters by low nibble, bit per high nibble
+    unsigned char high_nibbles[16];
+    unsigned char ascii;
+    unsigned char list_size; // delimiters compared directly if no more than list capacity
+    char list[STRING_TOKENIZER_LIST_CAPACITY];
+};
+typedef struct string_tokenizer string_tokenizer_t;
+
+// appended and prepended pieces are kept in chunks that never move, the string is built once
+struct string_builder {
+    string_builder_chunk_t *head;
+    string_builder_chunk_t *tail;
+    size_t size;
+    size_t chunk_capacity; // next chunk capacity, doubles up to 1 MiB
+};
+typedef struct string_builder string_builder_t;
+
+#define STRING_UTF8_INDEX_STRIDE 64 // code points between sampled byte offsets
+
+// sampled code point offsets, rebuilt after the string is edited
+struct string_utf8_index {
+    size_t *offsets; // byte offset of every STRING_UTF8_INDEX_STRIDE-th code point
+    size_t length; // code points
+};
+typedef struct string_utf8_index string_utf8_index_t;
+
 [[ nodiscard ]] string_t string_init(const char *cstr);
+[[ nodiscard ]] string_t string_init_n(const char *data, size_t size);
+// heap characters and their later edits come from the arena, which frees them on reset,
+// an inline string grown past STRING_SSO_CAPACITY by an edit still uses malloc
+[[ nodiscard ]] string_t string_init_in(string_arena_t *arena, const char *data, size_t size);
+// read only private mapping, copied on the first edit, the file must not shrink while mapped
+[[ nodiscard ]] string_t string_from_file_mmap(const char *path);
 [[ nodiscard ]] size_t string_length(const string_t *this);
 void string_insert(string_t *this, size_t index, const string_t *other);
 void string_rconcat(string_t *this, const string_t *other);
@@ -35,8 +106,64 @@ void string_set(string_t *this, size_t index, char c);
 void string_replace(string_t *this, const char *from, const char *to, unsigned char case_insensitive);
 [[ nodiscard ]] long long string_compare(const string_t *this, const string_t *other, unsigned char case_insensitive);
 [[ nodiscard ]] char *string_cstr(const string_t *this);
+// borrowed, NUL terminated unless this is a substring ending inside a longer string
+[[ nodiscard ]] const char *string_data(const string_t *this);
+// borrowed and always NUL terminated, such substrings are detached into their own buffer
+[[ nodiscard ]] const char *string_cstr_view(string_t *this);
+void string_to_lower(string_t *this);
+void string_to_upper(string_t *this);
 void string_reverse(string_t *this);
+// keeps the UTF-8 sequences in order, reversing code points
+void string_utf8_reverse(string_t *this);
 void string_delete(string_t *this);
 void string_print(const string_t *this);
+void string_append_u64(string_t *this, unsigned long long value);
+void string_append_i64(string_t *this, long long value);
+// shortest round trip digits, scientific from 1e16 and for small numbers with long fractions
+void string_append_f64(string_t *this, double value);
+// parse the number at the start of the range, returning the characters consumed or 0
+[[ nodiscard ]] size_t string_parse_u64(const string_t *this, size_t index, size_t count, unsigned long long *value);
+[[ nodiscard ]] size_t string_parse_i64(const string_t *this, size_t index, size_t count, long long *value);
+[[ nodiscard ]] size_t string_parse_f64(const string_t *this, size_t index, size_t count, double *value);
+[[ nodiscard ]] unsigned char string_utf8_validate(const string_t *this);
+// code points of valid UTF-8
+[[ nodiscard ]] size_t string_utf8_length(const string_t *this);
+[[ nodiscard ]] string_utf8_index_t string_utf8_index_init(const string_t *this);
+// byte offset of the code point, the string size past the end, linear without an index
+[[ nodiscard ]] size_t string_utf8_offset(const string_t *this, const string_utf8_index_t *index, size_t code_point);
+void string_utf8_index_delete(string_utf8_index_t *this);
+[[ nodiscard ]] size_t string_hash(const string_t *this);
+// hash_t and comparator_t adapters for hash maps keyed by string_t copies
+[[ nodiscard ]] size_t hash_string(size_t m, size_t size, const void *key);
+[[ nodiscard ]] signed char string_comparator(const void *this, const void *other);
+
+[[ nodiscard ]] string_view_t string_view(const string_t *this);
+[[ nodiscard ]] string_view_t string_view_init(const char *cstr);
+[[ nodiscard ]] string_view_t string_view_slice(string_view_t this, size_t index, size_t count);
+[[ nodiscard ]] long long string_view_lfind(string_view_t this, string_view_t str, unsigned char case_insensitive);
+[[ nodiscard ]] long long string_view_rfind(string_view_t this, string_view_t str, unsigned char case_insensitive);
+[[ nodiscard ]] long long string_view_compare(string_view_t this, string_view_t other, unsigned char case_insensitive);
+[[ nodiscard ]] size_t string_view_hash(string_view_t this);
+
+[[ nodiscard ]] size_t string_split(const string_t *this, const char *delimiters, string_span_t *spans, size_t max);
+[[ nodiscard ]] string_tokenizer_t string_tokenizer_init(string_view_t view, const char *delimiters);
+[[ nodiscard ]] unsigned char string_tokenizer_next(string_tokenizer_t *this, string_span_t *span);
+
+// bump allocated control blocks released all at once, not thread safe
+[[ nodiscard ]] string_arena_t *string_arena_init(size_t capacity);
+// bytes allocated since the last reset
+[[ nodiscard ]] size_t string_arena_size(const string_arena_t *this);
+// frees every string allocated from the arena, none of them may be used afterwards
+void string_arena_reset(string_arena_t *this);
+void string_arena_delete(string_arena_t *this);
+
+[[ nodiscard ]] string_builder_t string_builder_init(size_t capacity);
+[[ nodiscard ]] size_t string_builder_length(const string_builder_t *this);
+void string_builder_append(string_builder_t *this, string_view_t str);
+void string_builder_prepend(string_builder_t *this, string_view_t str);
+void string_builder_append_char(string_builder_t *this, char c);
+[[ nodiscard ]] string_t string_builder_build(const string_builder_t *this);
+void string_builder_clear(string_builder_t *this);
+void string_builder_delete(string_builder_t *this);
 
 #endif // STR_H
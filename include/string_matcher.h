@@ -0,0 +1,23 @@
+#ifndef STRING_MATCHER_H
+#define STRING_MATCHER_H
+
+#include "str.h"
+
+struct string_matcher;
+struct string_match {
+    size_t pattern; // index in the patterns the matcher was built from
+    size_t offset; // match start
+};
+
+typedef struct string_matcher string_matcher_t;
+typedef struct string_match string_match_t;
+
+// NULL and empty patterns never match
+[[ nodiscard ]] string_matcher_t *string_matcher_init(const char *const *, size_t, unsigned char);
+[[ nodiscard ]] size_t string_matcher_states(const string_matcher_t *);
+// every match counted in end order, longest first at the same end, only the first max written
+[[ nodiscard ]] size_t string_matcher_find(const string_matcher_t *, const string_t *, string_match_t *, size_t);
+[[ nodiscard ]] size_t string_matcher_view_find(const string_matcher_t *, string_view_t, string_match_t *, size_t);
+void string_matcher_delete(string_matcher_t *);
+
+#endif // STRING_MATCHER_H
@@ -0,0 +1,33 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include "str.h"
+
+struct string_pool;
+// interned strings live until the pool is deleted, equal strings share one handle
+struct string_interned {
+    size_t hash;
+    size_t size;
+    char data[]; // NUL terminated
+};
+struct string_pool_stats {
+    size_t strings; // unique interned strings
+    size_t references; // intern calls
+    size_t bytes; // unique characters and entry headers
+    size_t saved_bytes; // characters a separate copy per reference would take more
+};
+
+typedef struct string_pool string_pool_t;
+typedef struct string_interned string_interned_t;
+typedef struct string_pool_stats string_pool_stats_t;
+
+[[ nodiscard ]] string_pool_t *string_pool_init(size_t, unsigned char);
+[[ nodiscard ]] size_t string_pool_size(const string_pool_t *);
+[[ nodiscard ]] const string_interned_t *string_pool_intern(string_pool_t *, string_view_t);
+[[ nodiscard ]] const string_interned_t *string_pool_intern_cstr(string_pool_t *, const char *);
+[[ nodiscard ]] const string_interned_t *string_pool_intern_string(string_pool_t *, const string_t *);
+[[ nodiscard ]] const string_interned_t *string_pool_find(string_pool_t *, string_view_t);
+[[ nodiscard ]] string_pool_stats_t string_pool_stats(const string_pool_t *);
+void string_pool_delete(string_pool_t *);
+
+#endif // STRING_POOL_H
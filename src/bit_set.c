@@ -1,19 +1,134 @@
 #include "bit_set.h"
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
 
 #define BIT_SET_STACK_CAPACITY 2ul
+#define BIT_SET_WORD_BITS 64ul
+#define BIT_SET_RANK_BLOCK_WORDS 8ul // one cumulative count per 512 bits
+#define BIT_SET_SELECT_STRIDE 512ul // ones between select samples
 
+// Bits are stored in 64 bit words, bit i lives in word i / 64 at position i % 64.
+// While the words fit into stack_buffer they stay there, once they outgrow it
+// every word moves to heap_buffer, so the occupied words are always contiguous.
+// Bits past size in the last occupied word are kept zero.
+// The rank and select index is built by the first query after a mutation.
 struct bit_set {
-    unsigned char stack_buffer[BIT_SET_STACK_CAPACITY]; // Small Object Optimization
-    unsigned char *heap_buffer;
-    size_t heap_buffer_capacity;
+    uint64_t stack_buffer[BIT_SET_STACK_CAPACITY]; // Small Object Optimization
+    uint64_t *heap_buffer;
+    size_t heap_buffer_capacity; // in words
     size_t size;
+    size_t *rank_index; // ones before every rank block, then the total
+    size_t *select_index; // rank block holding every BIT_SET_SELECT_STRIDE-th one
+    unsigned char rank_index_valid;
 };
 
-[[nodiscard]] static size_t bits_to_chunks(const size_t bits) {
-    return bits / CHAR_BIT + !!(bits % CHAR_BIT);
+[[nodiscard]] static size_t bits_to_words(const size_t bits) {
+    return bits / BIT_SET_WORD_BITS + !!(bits % BIT_SET_WORD_BITS);
+}
+
+[[nodiscard]] static uint64_t *bit_set_words(bit_set_t *const this) {
+    return this->heap_buffer != NULL ? this->heap_buffer : this->stack_buffer;
+}
+
+[[nodiscard]] static const uint64_t *bit_set_const_words(const bit_set_t *const this) {
+    return this->heap_buffer != NULL ? this->heap_buffer : this->stack_buffer;
+}
+
+[[nodiscard]] static size_t bit_set_capacity(const bit_set_t *const this) {
+    return this->heap_buffer != NULL ? this->heap_buffer_capacity : BIT_SET_STACK_CAPACITY;
+}
+
+// Makes room for bits bits, name is the public function reported on failure
+[[nodiscard]] static unsigned char bit_set_reserve(bit_set_t *const this, const size_t bits, const char *const name) {
+    const size_t required_capacity = bits_to_words(bits);
+    if (required_capacity <= bit_set_capacity(this)) {
+        return 1;
+    }
+    const size_t heap_buffer_capacity = (required_capacity + 1ul) << 1;
+    uint64_t *const heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity * sizeof(uint64_t));
+    if (heap_buffer == NULL) {
+        fprintf(stderr, "malloc NULL return in %s for heap_buffer_capacity %lu\n", name, heap_buffer_capacity);
+        return 0;
+    }
+    if (this->heap_buffer == NULL) {
+        memcpy(heap_buffer, this->stack_buffer, sizeof(this->stack_buffer));
+    }
+    this->heap_buffer = heap_buffer;
+    this->heap_buffer_capacity = heap_buffer_capacity;
+    return 1;
+}
+
+[[nodiscard]] static unsigned char bit_set_grow(bit_set_t *const this, const char *const name) {
+    return bit_set_reserve(this, this->size + 1ul, name);
+}
+
+// Drops the last bit, which must already be zero, and gives memory back when a quarter is used
+static void bit_set_shrink(bit_set_t *const this, const char *const name) {
+    this->rank_index_valid = 0;
+    const size_t required_capacity = bits_to_words(this->size - 1ul);
+    if (this->heap_buffer != NULL && required_capacity + 1ul < this->heap_buffer_capacity >> 2) {
+        if (required_capacity + 1ul <= BIT_SET_STACK_CAPACITY) {
+            memcpy(this->stack_buffer, this->heap_buffer, required_capacity * sizeof(uint64_t));
+            free(this->heap_buffer);
+            this->heap_buffer = NULL;
+            this->heap_buffer_capacity = 0;
+        } else {
+            const size_t heap_buffer_capacity = (required_capacity + 1ul) << 1;
+            uint64_t *const heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity * sizeof(uint64_t));
+            if (heap_buffer == NULL) {
+                --this->size;
+                fprintf(stderr, "malloc NULL return in %s for heap_buffer_capacity %lu\n", name, heap_buffer_capacity);
+                return;
+            }
+            this->heap_buffer = heap_buffer;
+            this->heap_buffer_capacity = heap_buffer_capacity;
+        }
+    }
+    --this->size;
+}
+
+// Moves bits [index, size) one position up and stores b at index
+static void bit_set_shift_in(bit_set_t *const this, const size_t index, const bit_t b) {
+    uint64_t *const words = bit_set_words(this);
+    const size_t word_index = index / BIT_SET_WORD_BITS;
+    const size_t bit_index = index % BIT_SET_WORD_BITS;
+    const size_t last = this->size / BIT_SET_WORD_BITS;
+    if (!(this->size % BIT_SET_WORD_BITS)) {
+        words[last] = 0;
+    }
+    for (size_t i = last; i > word_index; --i) {
+        words[i] = (words[i] << 1) | (words[i - 1ul] >> (BIT_SET_WORD_BITS - 1ul));
+    }
+    const uint64_t low = (UINT64_C(1) << bit_index) - 1ul;
+    const uint64_t word = words[word_index];
+    words[word_index] = (word & low) | ((word & ~low) << 1) | ((uint64_t)b << bit_index);
+}
+
+// Moves bits (index, size) one position down, the top bit becomes zero
+static void bit_set_shift_out(bit_set_t *const this, const size_t index) {
+    uint64_t *const words = bit_set_words(this);
+    const size_t word_index = index / BIT_SET_WORD_BITS;
+    const size_t bit_index = index % BIT_SET_WORD_BITS;
+    const size_t last = (this->size - 1ul) / BIT_SET_WORD_BITS;
+    const uint64_t low = (UINT64_C(1) << bit_index) - 1ul;
+    const uint64_t word = words[word_index];
+    if (word_index == last) {
+        words[word_index] = (word & low) | ((word >> 1) & ~low);
+        return;
+    }
+    words[word_index] = (word & low) | ((word >> 1) & ~low) | (words[word_index + 1ul] << (BIT_SET_WORD_BITS - 1ul));
+    for (size_t i = word_index + 1ul; i < last; ++i) {
+        words[i] = (words[i] >> 1) | (words[i + 1ul] << (BIT_SET_WORD_BITS - 1ul));
+    }
+    words[last] >>= 1;
 }
 
 [[nodiscard]] bit_set_t *bit_set_init(const size_t capacity) {
@@ -22,19 +137,21 @@ struct bit_set {
         fprintf(stderr, "malloc NULL return in bit_set_init");
         return bs;
     }
+    memset(bs->stack_buffer, 0, sizeof(bs->stack_buffer));
     bs->heap_buffer = NULL;
     bs->heap_buffer_capacity = 0ul;
     bs->size = 0ul;
-    const size_t chunks_capacity = bits_to_chunks(capacity);
-    if (chunks_capacity > BIT_SET_STACK_CAPACITY) {
-        const size_t heap_buffer_capacity = chunks_capacity - BIT_SET_STACK_CAPACITY;
-        bs->heap_buffer = malloc(heap_buffer_capacity);
+    bs->rank_index = NULL;
+    bs->select_index = NULL;
+    bs->rank_index_valid = 0;
+    const size_t words_capacity = bits_to_words(capacity);
+    if (words_capacity > BIT_SET_STACK_CAPACITY) {
+        bs->heap_buffer = malloc(words_capacity * sizeof(uint64_t));
         if (bs->heap_buffer == NULL) {
-            bs->heap_buffer_capacity = 0ul;
-            fprintf(stderr, "malloc NULL return in bit_set_init for heap_buffer_capacity %lu\n", heap_buffer_capacity);
+            fprintf(stderr, "malloc NULL return in bit_set_init for heap_buffer_capacity %lu\n", words_capacity);
             return bs;
         }
-        bs->heap_buffer_capacity = heap_buffer_capacity;
+        bs->heap_buffer_capacity = words_capacity;
     }
     return bs;
 }
@@ -61,134 +178,12 @@ void bit_set_insert(
     if (b > ONE) {
         b = ONE;
     }
-    // heap reallocation
-    size_t heap_buffer_capacity = this->heap_buffer_capacity;
-    unsigned char *heap_buffer = this->heap_buffer;
-    const size_t required_capacity = bits_to_chunks(this->size + 1ul);
-    if (required_capacity > BIT_SET_STACK_CAPACITY + this->heap_buffer_capacity) {
-        heap_buffer_capacity = (required_capacity - BIT_SET_STACK_CAPACITY + 1ul) << 1;
-        heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity);
-        if (heap_buffer == NULL) {
-            fprintf(stderr, "malloc NULL return in bit_set_insert for heap_buffer_capacity %lu\n", heap_buffer_capacity);
-            return;
-        }
-    }
-    // insertion
-    const size_t insertion_chunk_index = abs_index / CHAR_BIT;
-    const unsigned char insertion_bit_index = abs_index % CHAR_BIT;
-    if (insertion_chunk_index >= BIT_SET_STACK_CAPACITY) { // heap insertion
-        const size_t insertion_offset = insertion_chunk_index - BIT_SET_STACK_CAPACITY;
-        unsigned char *insertion_chunk = heap_buffer + insertion_offset;
-        if (abs_index == this->size) {
-            if (b == ZERO) {
-                *insertion_chunk = *insertion_chunk & ~(1u << insertion_bit_index);
-            } else {
-                *insertion_chunk = *insertion_chunk | (1u << insertion_bit_index);
-            }
-        } else {
-            // heap shifting
-            size_t chunk_offset = insertion_offset;
-            bit_t old_bit;
-            bit_t new_bit = b;
-            if (insertion_bit_index > 0) {
-                for (unsigned char i = insertion_bit_index; i < CHAR_BIT; ++i) {
-                    old_bit = (*insertion_chunk >> i) & 1u;
-                    if (new_bit == ZERO) {
-                        *insertion_chunk = *insertion_chunk & ~(1u << i);
-                    } else {
-                        *insertion_chunk = *insertion_chunk | (1u << i);
-                    }
-                    new_bit = old_bit;
-                }
-                ++chunk_offset;
-            }
-            const size_t occupied_heap_buffer_capacity = bits_to_chunks(this->size - BIT_SET_STACK_CAPACITY * CHAR_BIT);
-            for (size_t i = chunk_offset; i < occupied_heap_buffer_capacity; ++i) {
-                unsigned char *current_chunk = heap_buffer + i;
-                old_bit = (*current_chunk >> (CHAR_BIT - 1)) & 1u;
-                *current_chunk = *current_chunk << 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~1u;
-                } else {
-                    *current_chunk = *current_chunk | 1u;
-                }
-                new_bit = old_bit;
-            }
-            const unsigned char last_chunk_unoccupied = !(this->size % CHAR_BIT);
-            if (last_chunk_unoccupied) {
-                unsigned char *last_chunk = heap_buffer + occupied_heap_buffer_capacity;
-                if (new_bit == ZERO) {
-                    *last_chunk = *last_chunk & ~1u;
-                } else {
-                    *last_chunk = *last_chunk | 1u;
-                }
-            }
-        }
-    } else { // stack insertion
-        unsigned char *insertion_chunk = this->stack_buffer + insertion_chunk_index;
-        if (abs_index == this->size) {
-            if (b == ZERO) {
-                *insertion_chunk = *insertion_chunk & ~(1u << insertion_bit_index);
-            } else {
-                *insertion_chunk = *insertion_chunk | (1u << insertion_bit_index);
-            }
-        } else {
-            // stack shifting
-            size_t chunk_offset = insertion_chunk_index;
-            bit_t old_bit;
-            bit_t new_bit = b;
-            if (insertion_bit_index > 0) {
-                for (unsigned char i = insertion_bit_index; i < CHAR_BIT; ++i) {
-                    old_bit = (*insertion_chunk >> i) & 1u;
-                    if (new_bit == ZERO) {
-                        *insertion_chunk = *insertion_chunk & ~(1u << i);
-                    } else {
-                        *insertion_chunk = *insertion_chunk | (1u << i);
-                    }
-                    new_bit = old_bit;
-                }
-                ++chunk_offset;
-            }
-            for (size_t i = chunk_offset; i < BIT_SET_STACK_CAPACITY; ++i) {
-                unsigned char *current_chunk = this->stack_buffer + i;
-                old_bit = (*current_chunk >> (CHAR_BIT - 1)) & 1u;
-                *current_chunk = *current_chunk << 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~1u;
-                } else {
-                    *current_chunk = *current_chunk | 1u;
-                }
-                new_bit = old_bit;
-            }
-            // heap shifting
-            if (required_capacity > BIT_SET_STACK_CAPACITY) {
-                const size_t occupied_heap_buffer_capacity = bits_to_chunks(this->size - BIT_SET_STACK_CAPACITY * CHAR_BIT);
-                for (size_t i = 0; i < occupied_heap_buffer_capacity; ++i) {
-                    unsigned char *current_chunk = heap_buffer + i;
-                    old_bit = (*current_chunk >> (CHAR_BIT - 1)) & 1u;
-                    *current_chunk = *current_chunk << 1;
-                    if (new_bit == ZERO) {
-                        *current_chunk = *current_chunk & ~1u;
-                    } else {
-                        *current_chunk = *current_chunk | 1u;
-                    }
-                    new_bit = old_bit;
-                }
-                const unsigned char last_chunk_unoccupied = !(this->size % CHAR_BIT);
-                if (last_chunk_unoccupied) {
-                    unsigned char *last_chunk = heap_buffer + occupied_heap_buffer_capacity;
-                    if (new_bit == ZERO) {
-                        *last_chunk = *last_chunk & ~1u;
-                    } else {
-                        *last_chunk = *last_chunk | 1u;
-                    }
-                }
-            }
-        }
+    if (!bit_set_grow(this, "bit_set_insert")) {
+        return;
     }
-    this->heap_buffer = heap_buffer;
-    this->heap_buffer_capacity = heap_buffer_capacity;
+    bit_set_shift_in(this, abs_index, b);
     ++this->size;
+    this->rank_index_valid = 0;
 }
 
 void bit_set_push_back(
@@ -201,38 +196,20 @@ void bit_set_push_back(
     if (b > ONE) {
         b = ONE;
     }
-    // heap reallocation
-    size_t heap_buffer_capacity = this->heap_buffer_capacity;
-    unsigned char *heap_buffer = this->heap_buffer;
-    const size_t required_capacity = bits_to_chunks(this->size + 1ul);
-    if (required_capacity > BIT_SET_STACK_CAPACITY + this->heap_buffer_capacity) {
-        heap_buffer_capacity = (required_capacity - BIT_SET_STACK_CAPACITY + 1ul) << 1;
-        heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity);
-        if (heap_buffer == NULL) {
-            fprintf(stderr, "malloc NULL return in bit_set_push_back for heap_buffer_capacity %lu\n", heap_buffer_capacity);
-            return;
-        }
-    }
-    // insertion
-    const size_t insertion_chunk_index = this->size / CHAR_BIT;
-    const size_t bit_index = this->size % CHAR_BIT;
-    unsigned char *insertion_chunk;
-    if (insertion_chunk_index >= BIT_SET_STACK_CAPACITY) {
-        insertion_chunk = heap_buffer + insertion_chunk_index - BIT_SET_STACK_CAPACITY;
-    } else {
-        insertion_chunk = this->stack_buffer + insertion_chunk_index;
+    if (!bit_set_grow(this, "bit_set_push_back")) {
+        return;
     }
-    if (b == ZERO) {
-        *insertion_chunk = *insertion_chunk & ~(1u << bit_index);
-    } else {
-        *insertion_chunk = *insertion_chunk | (1u << bit_index);
+    uint64_t *const words = bit_set_words(this);
+    const size_t word_index = this->size / BIT_SET_WORD_BITS;
+    const size_t bit_index = this->size % BIT_SET_WORD_BITS;
+    if (!bit_index) {
+        words[word_index] = 0;
     }
-    this->heap_buffer = heap_buffer;
-    this->heap_buffer_capacity = heap_buffer_capacity;
+    words[word_index] |= (uint64_t)b << bit_index;
     ++this->size;
+    this->rank_index_valid = 0;
 }
 
-
 void bit_set_push_front(
     bit_set_t *const this,
     bit_t b
@@ -243,105 +220,12 @@ void bit_set_push_front(
     if (b > ONE) {
         b = ONE;
     }
-    // heap reallocation
-    size_t heap_buffer_capacity = this->heap_buffer_capacity;
-    unsigned char *heap_buffer = this->heap_buffer;
-    const size_t required_capacity = bits_to_chunks(this->size + 1ul);
-    if (required_capacity > BIT_SET_STACK_CAPACITY + this->heap_buffer_capacity) {
-        heap_buffer_capacity = (required_capacity - BIT_SET_STACK_CAPACITY + 1ul) << 1;
-        heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity);
-        if (heap_buffer == NULL) {
-            fprintf(stderr, "malloc NULL return in bit_set_push_front for heap_buffer_capacity %lu\n", heap_buffer_capacity);
-            return;
-        }
-    }
-    // insertion
-    if (BIT_SET_STACK_CAPACITY == 0ul) {
-        unsigned char *insertion_chunk = heap_buffer;
-        if (this->size == 0ul) {
-            if (b == ZERO) {
-                *insertion_chunk = *insertion_chunk & ~1u;
-            } else {
-                *insertion_chunk = *insertion_chunk | 1u;
-            }
-        } else {
-            // heap shifting
-            bit_t old_bit;
-            bit_t new_bit = b;
-            const size_t occupied_heap_buffer_capacity = bits_to_chunks(this->size - BIT_SET_STACK_CAPACITY * CHAR_BIT);
-            for (size_t i = 0ul; i < occupied_heap_buffer_capacity; ++i) {
-                unsigned char *current_chunk = heap_buffer + i;
-                old_bit = (*current_chunk >> (CHAR_BIT - 1)) & 1u;
-                *current_chunk = *current_chunk << 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~1u;
-                } else {
-                    *current_chunk = *current_chunk | 1u;
-                }
-                new_bit = old_bit;
-            }
-            const unsigned char last_chunk_unoccupied = !(this->size % CHAR_BIT);
-            if (last_chunk_unoccupied) {
-                unsigned char *last_chunk = heap_buffer + occupied_heap_buffer_capacity;
-                if (new_bit == ZERO) {
-                    *last_chunk = *last_chunk & ~1u;
-                } else {
-                    *last_chunk = *last_chunk | 1u;
-                }
-            }
-        }
-    } else {
-        unsigned char *insertion_chunk = this->stack_buffer;
-        if (this->size == 0) {
-            if (b == ZERO) {
-                *insertion_chunk = *insertion_chunk & ~1u;
-            } else {
-                *insertion_chunk = *insertion_chunk | 1u;
-            }
-        } else {
-            // stack shifting
-            bit_t old_bit;
-            bit_t new_bit = b;
-            for (size_t i = 0; i < BIT_SET_STACK_CAPACITY; ++i) {
-                unsigned char *current_chunk = this->stack_buffer + i;
-                old_bit = (*current_chunk >> (CHAR_BIT - 1)) & 1u;
-                *current_chunk = *current_chunk << 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~1u;
-                } else {
-                    *current_chunk = *current_chunk | 1u;
-                }
-                new_bit = old_bit;
-            }
-            // heap shifting
-            if (required_capacity > BIT_SET_STACK_CAPACITY) {
-                const size_t occupied_heap_buffer_capacity = bits_to_chunks(this->size - BIT_SET_STACK_CAPACITY * CHAR_BIT);
-                for (size_t i = 0; i < occupied_heap_buffer_capacity; ++i) {
-                    unsigned char *current_chunk = heap_buffer + i;
-                    old_bit = (*current_chunk >> (CHAR_BIT - 1)) & 1u;
-                    *current_chunk = *current_chunk << 1;
-                    if (new_bit == ZERO) {
-                        *current_chunk = *current_chunk & ~1u;
-                    } else {
-                        *current_chunk = *current_chunk | 1u;
-                    }
-                    new_bit = old_bit;
-                }
-                const unsigned char last_chunk_unoccupied = !(this->size % CHAR_BIT);
-                if (last_chunk_unoccupied) {
-                    unsigned char *last_chunk = heap_buffer + occupied_heap_buffer_capacity;
-                    if (new_bit == ZERO) {
-                        *last_chunk = *last_chunk & ~1u;
-                    } else {
-                        *last_chunk = *last_chunk | 1u;
-                    }
-                }
-            }
-        }
+    if (!bit_set_grow(this, "bit_set_push_front")) {
+        return;
     }
-    this->heap_buffer = heap_buffer;
-    this->heap_buffer_capacity = heap_buffer_capacity;
+    bit_set_shift_in(this, 0ul, b);
     ++this->size;
+    this->rank_index_valid = 0;
 }
 
 void bit_set_remove(
@@ -355,219 +239,25 @@ void bit_set_remove(
     if (abs_index >= this->size) {
         return;
     }
-    // removal
-    if (abs_index < this->size - 1ul) {
-        const size_t removal_chunk_index = abs_index / CHAR_BIT;
-        const unsigned char removal_bit_index = abs_index % CHAR_BIT;
-        const size_t occupied_heap_buffer_capacity = bits_to_chunks(this->size - BIT_SET_STACK_CAPACITY * CHAR_BIT);
-        bit_t old_bit;
-        bit_t new_bit = ZERO;
-        if (removal_chunk_index >= BIT_SET_STACK_CAPACITY) { // heap removal
-            const size_t heap_removal_chunk_index = removal_chunk_index - BIT_SET_STACK_CAPACITY;
-            // heap shifting
-            if (removal_bit_index == 0) {
-                for (long long i = (long long)occupied_heap_buffer_capacity - 1ll; i >= (long long)heap_removal_chunk_index; --i) {
-                    unsigned char *current_chunk = this->heap_buffer + i;
-                    old_bit = *current_chunk & 1u;
-                    *current_chunk = *current_chunk >> 1;
-                    if (new_bit == ZERO) {
-                        *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                    } else {
-                        *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                    }
-                    new_bit = old_bit;
-                }
-            } else {
-                for (long long i = (long long)occupied_heap_buffer_capacity - 1ll; i > (long long)heap_removal_chunk_index; --i) {
-                    unsigned char *current_chunk = this->heap_buffer + i;
-                    old_bit = *current_chunk & 1u;
-                    *current_chunk = *current_chunk >> 1;
-                    if (new_bit == ZERO) {
-                        *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                    } else {
-                        *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                    }
-                    new_bit = old_bit;
-                }
-                unsigned char *removal_chunk = this->heap_buffer + heap_removal_chunk_index;
-                for (short i = CHAR_BIT - 1; i >= (short)removal_bit_index; --i) {
-                    old_bit = (*removal_chunk >> i) & 1u;
-                    if (new_bit == ZERO) {
-                        *removal_chunk = *removal_chunk & ~(1u << i);
-                    } else {
-                        *removal_chunk = *removal_chunk | (1u << i);
-                    }
-                    new_bit = old_bit;
-                }
-            }
-        } else { // stack removal
-            // heap shifting
-            for (long long i = (long long)occupied_heap_buffer_capacity - 1ll; i >= 0ll; --i) {
-                unsigned char *current_chunk = this->heap_buffer + i;
-                old_bit = *current_chunk & 1u;
-                *current_chunk = *current_chunk >> 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                } else {
-                    *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                }
-                new_bit = old_bit;
-            }
-            // stack shifting
-            if (removal_bit_index == 0) {
-                for (long long i = (long long)BIT_SET_STACK_CAPACITY - 1ll; i >= (long long)removal_chunk_index; --i) {
-                    unsigned char *current_chunk = this->stack_buffer + i;
-                    old_bit = *current_chunk & 1u;
-                    *current_chunk = *current_chunk >> 1;
-                    if (new_bit == ZERO) {
-                        *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                    } else {
-                        *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                    }
-                    new_bit = old_bit;
-                }
-            } else {
-                for (long long i = (long long)BIT_SET_STACK_CAPACITY - 1ll; i > (long long)removal_chunk_index; --i) {
-                    unsigned char *current_chunk = this->stack_buffer + i;
-                    old_bit = *current_chunk & 1u;
-                    *current_chunk = *current_chunk >> 1;
-                    if (new_bit == ZERO) {
-                        *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                    } else {
-                        *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                    }
-                    new_bit = old_bit;
-                }
-                unsigned char *removal_chunk = this->stack_buffer + removal_chunk_index;
-                for (short i = CHAR_BIT - 1; i >= (short)removal_bit_index; --i) {
-                    old_bit = (*removal_chunk >> i) & 1u;
-                    if (new_bit == ZERO) {
-                        *removal_chunk = *removal_chunk & ~(1u << i);
-                    } else {
-                        *removal_chunk = *removal_chunk | (1u << i);
-                    }
-                    new_bit = old_bit;
-                }
-            }
-        }
-    }
-    // heap reallocation
-    const size_t required_capacity = bits_to_chunks(this->size - 1ul);
-    if (required_capacity + 1ul < (BIT_SET_STACK_CAPACITY + this->heap_buffer_capacity) >> 2) {
-        if (required_capacity + 1ul <= BIT_SET_STACK_CAPACITY) {
-            free(this->heap_buffer);
-            this->heap_buffer = NULL;
-            this->heap_buffer_capacity = 0;
-        } else {
-            const size_t heap_buffer_capacity = (required_capacity - BIT_SET_STACK_CAPACITY + 1ul) << 1;
-            unsigned char *const heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity);
-            if (heap_buffer == NULL) {
-                --this->size;
-                fprintf(stderr, "malloc NULL return in bit_set_remove for heap_buffer_capacity %lu\n", heap_buffer_capacity);
-                return;
-            }
-            this->heap_buffer = heap_buffer;
-            this->heap_buffer_capacity = heap_buffer_capacity;
-        }
-    }
-    --this->size;
+    bit_set_shift_out(this, abs_index);
+    bit_set_shrink(this, "bit_set_remove");
 }
 
 void bit_set_pop_back(bit_set_t *const this) {
     if (this == NULL || !this->size) {
         return;
     }
-    // heap reallocation
-    const size_t required_capacity = bits_to_chunks(this->size - 1ul);
-    if (required_capacity + 1ul < (BIT_SET_STACK_CAPACITY + this->heap_buffer_capacity) >> 2) {
-        if (required_capacity + 1ul <= BIT_SET_STACK_CAPACITY) {
-            free(this->heap_buffer);
-            this->heap_buffer = NULL;
-            this->heap_buffer_capacity = 0;
-        } else {
-            const size_t heap_buffer_capacity = (required_capacity - BIT_SET_STACK_CAPACITY + 1ul) << 1;
-            unsigned char *const heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity);
-            if (heap_buffer == NULL) {
-                --this->size;
-                fprintf(stderr, "malloc NULL return in bit_set_pop_back for heap_buffer_capacity %lu\n", heap_buffer_capacity);
-                return;
-            }
-            this->heap_buffer = heap_buffer;
-            this->heap_buffer_capacity = heap_buffer_capacity;
-        }
-    }
-    --this->size;
+    const size_t last = this->size - 1ul;
+    bit_set_words(this)[last / BIT_SET_WORD_BITS] &= ~(UINT64_C(1) << (last % BIT_SET_WORD_BITS));
+    bit_set_shrink(this, "bit_set_pop_back");
 }
 
 void bit_set_pop_front(bit_set_t *const this) {
     if (this == NULL || !this->size) {
         return;
     }
-    // removal
-    if (this->size > 1ul) {
-        const size_t occupied_heap_buffer_capacity = bits_to_chunks(this->size - BIT_SET_STACK_CAPACITY * CHAR_BIT);
-        bit_t old_bit;
-        bit_t new_bit = ZERO;
-        if (BIT_SET_STACK_CAPACITY == 0ul) { // heap removal
-            // heap shifting
-            for (long long i = (long long)occupied_heap_buffer_capacity - 1ll; i >= 0ll; --i) {
-                unsigned char *current_chunk = this->heap_buffer + i;
-                old_bit = *current_chunk & 1u;
-                *current_chunk = *current_chunk >> 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                } else {
-                    *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                }
-                new_bit = old_bit;
-            }
-        } else { // stack removal
-            // heap shifting
-            for (long long i = (long long)occupied_heap_buffer_capacity - 1ll; i >= 0ll; --i) {
-                unsigned char *current_chunk = this->heap_buffer + i;
-                old_bit = *current_chunk & 1u;
-                *current_chunk = *current_chunk >> 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                } else {
-                    *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                }
-                new_bit = old_bit;
-            }
-            // stack shifting
-            for (long long i = (long long)BIT_SET_STACK_CAPACITY - 1ll; i >= 0ll; --i) {
-                unsigned char *current_chunk = this->stack_buffer + i;
-                old_bit = *current_chunk & 1u;
-                *current_chunk = *current_chunk >> 1;
-                if (new_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~(1u << (CHAR_BIT - 1));
-                } else {
-                    *current_chunk = *current_chunk | (1u << (CHAR_BIT - 1));
-                }
-                new_bit = old_bit;
-            }
-        }
-    }
-    // heap reallocation
-    const size_t required_capacity = bits_to_chunks(this->size - 1ul);
-    if (required_capacity + 1ul < (BIT_SET_STACK_CAPACITY + this->heap_buffer_capacity) >> 2) {
-        if (required_capacity + 1ul <= BIT_SET_STACK_CAPACITY) {
-            free(this->heap_buffer);
-            this->heap_buffer = NULL;
-            this->heap_buffer_capacity = 0;
-        } else {
-            const size_t heap_buffer_capacity = (required_capacity - BIT_SET_STACK_CAPACITY + 1ul) << 1;
-            unsigned char *const heap_buffer = realloc(this->heap_buffer, heap_buffer_capacity);
-            if (heap_buffer == NULL) {
-                --this->size;
-                fprintf(stderr, "malloc NULL return in bit_set_pop_front for heap_buffer_capacity %lu\n", heap_buffer_capacity);
-                return;
-            }
-            this->heap_buffer = heap_buffer;
-            this->heap_buffer_capacity = heap_buffer_capacity;
-        }
-    }
-    --this->size;
+    bit_set_shift_out(this, 0ul);
+    bit_set_shrink(this, "bit_set_pop_front");
 }
 
 void bit_set_set(
@@ -585,19 +275,10 @@ void bit_set_set(
     if (b > ONE) {
         b = ONE;
     }
-    const size_t chunk_index = abs_index / CHAR_BIT;
-    const size_t bit_index = abs_index % CHAR_BIT;
-    unsigned char *chunk;
-    if (chunk_index < BIT_SET_STACK_CAPACITY) {
-        chunk = this->stack_buffer + chunk_index;
-    } else {
-        chunk = this->heap_buffer + chunk_index - BIT_SET_STACK_CAPACITY;
-    }
-    if (b == ZERO) {
-        *chunk = *chunk & ~(1u << bit_index);
-    } else {
-        *chunk = *chunk | (1u << bit_index);
-    }
+    uint64_t *const word = bit_set_words(this) + abs_index / BIT_SET_WORD_BITS;
+    const size_t bit_index = abs_index % BIT_SET_WORD_BITS;
+    *word = (*word & ~(UINT64_C(1) << bit_index)) | ((uint64_t)b << bit_index);
+    this->rank_index_valid = 0;
 }
 
 [[nodiscard]] bit_t bit_set_get(
@@ -608,130 +289,426 @@ void bit_set_set(
         return ZERO;
     }
     const size_t abs_index = index < 0 ? index % (long long)this->size : index;
-    if (abs_index > this->size) {
+    if (abs_index >= this->size) {
         return ZERO;
     }
-    const size_t chunk_index = abs_index / CHAR_BIT;
-    const size_t bit_index = abs_index % CHAR_BIT;
-    const unsigned char *chunk;
-    if (chunk_index < BIT_SET_STACK_CAPACITY) {
-        chunk = this->stack_buffer + chunk_index;
-    } else {
-        chunk = this->heap_buffer + chunk_index - BIT_SET_STACK_CAPACITY;
-    }
-    return (*chunk >> bit_index) & 1u;
+    const uint64_t word = bit_set_const_words(this)[abs_index / BIT_SET_WORD_BITS];
+    return (word >> (abs_index % BIT_SET_WORD_BITS)) & 1u;
 }
 
-static void bit_set_bit_reverse(unsigned char *chunk) {
-    unsigned char i = 0;
-    unsigned char j = CHAR_BIT - 1;
+[[nodiscard]] static uint64_t bit_set_word_reverse(uint64_t word) {
+    word = ((word >> 1) & UINT64_C(0x5555555555555555)) | ((word & UINT64_C(0x5555555555555555)) << 1);
+    word = ((word >> 2) & UINT64_C(0x3333333333333333)) | ((word & UINT64_C(0x3333333333333333)) << 2);
+    word = ((word >> 4) & UINT64_C(0x0f0f0f0f0f0f0f0f)) | ((word & UINT64_C(0x0f0f0f0f0f0f0f0f)) << 4);
+    return __builtin_bswap64(word);
+}
+
+void bit_set_reverse(bit_set_t *const this) {
+    if (this == NULL || this->size < 2ul) {
+        return;
+    }
+    this->rank_index_valid = 0;
+    uint64_t *const words = bit_set_words(this);
+    const size_t words_size = bits_to_words(this->size);
+    // words and bits reverse
+    size_t i = 0;
+    size_t j = words_size - 1ul;
     while (i < j) {
-        const bit_t bit_i = (*chunk >> i) & 1u;
-        const bit_t bit_j = (*chunk >> j) & 1u;
-        if (bit_j == ZERO) {
-            *chunk = *chunk & ~(1u << i);
-        } else {
-            *chunk = *chunk | (1u << i);
-        }
-        if (bit_i == ZERO) {
-            *chunk = *chunk & ~(1u << j);
-        } else {
-            *chunk = *chunk | (1u << j);
-        }
+        const uint64_t word_i = bit_set_word_reverse(words[i]);
+        words[i] = bit_set_word_reverse(words[j]);
+        words[j] = word_i;
         ++i;
         --j;
     }
+    if (i == j) {
+        words[i] = bit_set_word_reverse(words[i]);
+    }
+    // the zero tail is now in front, shift it out
+    const size_t shift = words_size * BIT_SET_WORD_BITS - this->size;
+    if (shift) {
+        for (size_t k = 0; k + 1ul < words_size; ++k) {
+            words[k] = (words[k] >> shift) | (words[k + 1ul] << (BIT_SET_WORD_BITS - shift));
+        }
+        words[words_size - 1ul] >>= shift;
+    }
 }
 
-void bit_set_reverse(bit_set_t *const this) {
-    if (this == NULL || this->size < 2ul) {
+typedef enum : unsigned char {
+    BIT_SET_AND,
+    BIT_SET_OR,
+    BIT_SET_XOR,
+    BIT_SET_ANDNOT
+} bit_set_operation_t;
+
+#ifdef __AVX2__
+[[nodiscard]] static inline __m256i combine_256(const __m256i a, const __m256i b, const bit_set_operation_t operation) {
+    switch (operation) {
+        case BIT_SET_AND: return _mm256_and_si256(a, b);
+        case BIT_SET_OR: return _mm256_or_si256(a, b);
+        case BIT_SET_XOR: return _mm256_xor_si256(a, b);
+        default: return _mm256_andnot_si256(b, a);
+    }
+}
+#endif
+
+#ifdef __SSE2__
+[[nodiscard]] static inline __m128i combine_128(const __m128i a, const __m128i b, const bit_set_operation_t operation) {
+    switch (operation) {
+        case BIT_SET_AND: return _mm_and_si128(a, b);
+        case BIT_SET_OR: return _mm_or_si128(a, b);
+        case BIT_SET_XOR: return _mm_xor_si128(a, b);
+        default: return _mm_andnot_si128(b, a);
+    }
+}
+#endif
+
+[[nodiscard]] static inline uint64_t combine_64(const uint64_t a, const uint64_t b, const bit_set_operation_t operation) {
+    switch (operation) {
+        case BIT_SET_AND: return a & b;
+        case BIT_SET_OR: return a | b;
+        case BIT_SET_XOR: return a ^ b;
+        default: return a & ~b;
+    }
+}
+
+// destination may alias a or b, the words are combined index by index
+static inline void combine_words(
+    uint64_t *const destination,
+    const uint64_t *const a,
+    const uint64_t *const b,
+    const size_t size,
+    const bit_set_operation_t operation
+) {
+    size_t i = 0;
+#ifdef __AVX2__
+    for (; i + 4 <= size; i += 4) {
+        const __m256i block_a = _mm256_loadu_si256((const __m256i *)(a + i));
+        const __m256i block_b = _mm256_loadu_si256((const __m256i *)(b + i));
+        _mm256_storeu_si256((__m256i *)(destination + i), combine_256(block_a, block_b, operation));
+    }
+#endif
+#ifdef __SSE2__
+    for (; i + 2 <= size; i += 2) {
+        const __m128i block_a = _mm_loadu_si128((const __m128i *)(a + i));
+        const __m128i block_b = _mm_loadu_si128((const __m128i *)(b + i));
+        _mm_storeu_si128((__m128i *)(destination + i), combine_128(block_a, block_b, operation));
+    }
+#endif
+    for (; i < size; ++i) {
+        destination[i] = combine_64(a[i], b[i], operation);
+    }
+}
+
+static void invert_words(uint64_t *const destination, const uint64_t *const source, const size_t size) {
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i ones_256 = _mm256_set1_epi64x(-1);
+    for (; i + 4 <= size; i += 4) {
+        const __m256i block = _mm256_loadu_si256((const __m256i *)(source + i));
+        _mm256_storeu_si256((__m256i *)(destination + i), _mm256_xor_si256(block, ones_256));
+    }
+#endif
+#ifdef __SSE2__
+    const __m128i ones_128 = _mm_set1_epi64x(-1);
+    for (; i + 2 <= size; i += 2) {
+        const __m128i block = _mm_loadu_si128((const __m128i *)(source + i));
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_xor_si128(block, ones_128));
+    }
+#endif
+    for (; i < size; ++i) {
+        destination[i] = ~source[i];
+    }
+}
+
+// this = a operation b, the shorter operand reads as zero extended to the longer size
+static void bit_set_combine(
+    bit_set_t *const this,
+    const bit_set_t *const a,
+    const bit_set_t *const b,
+    const bit_set_operation_t operation,
+    const char *const name
+) {
+    if (this == NULL || a == NULL || b == NULL) {
         return;
     }
-    // shifting
-    const unsigned char last_chunk_occupied_size = this->size % CHAR_BIT;
-    if (last_chunk_occupied_size) {
-        const unsigned char last_chunk_free_size = CHAR_BIT - last_chunk_occupied_size;
-        unsigned char old_chunk;
-        unsigned char new_chunk = 0;
-        // stack shifting
-        for (size_t i = 0; i < BIT_SET_STACK_CAPACITY; ++i) {
-            unsigned char *current_chunk = this->stack_buffer + i;
-            old_chunk = *current_chunk;
-            *current_chunk = *current_chunk << last_chunk_free_size;
-            for (unsigned char j = last_chunk_occupied_size; j < CHAR_BIT; ++j) {
-                const bit_t current_bit = (new_chunk >> j) & 1u;
-                if (current_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~(1u << (j - last_chunk_occupied_size));
-                } else {
-                    *current_chunk = *current_chunk | (1u << (j - last_chunk_occupied_size));
-                }
-            }
-            new_chunk = old_chunk;
+    const size_t size = a->size > b->size ? a->size : b->size;
+    // a and b sizes are read first, this may alias either of them
+    const size_t a_words_size = bits_to_words(a->size);
+    const size_t b_words_size = bits_to_words(b->size);
+    if (!bit_set_reserve(this, size, name)) {
+        return;
+    }
+    uint64_t *const words = bit_set_words(this);
+    const uint64_t *const a_words = bit_set_const_words(a);
+    const uint64_t *const b_words = bit_set_const_words(b);
+    const size_t common_words_size = a_words_size < b_words_size ? a_words_size : b_words_size;
+    combine_words(words, a_words, b_words, common_words_size, operation);
+    // past the shorter operand: and keeps nothing, andnot keeps a, or and xor keep the longer one
+    if (a_words_size > common_words_size) {
+        const size_t tail = a_words_size - common_words_size;
+        if (operation == BIT_SET_AND) {
+            memset(words + common_words_size, 0, tail * sizeof(uint64_t));
+        } else if (words != a_words) {
+            memcpy(words + common_words_size, a_words + common_words_size, tail * sizeof(uint64_t));
         }
-        // heap_shifting
-        const size_t occupied_heap_buffer_capacity = bits_to_chunks(this->size - BIT_SET_STACK_CAPACITY * CHAR_BIT);
-        for (size_t i = 0; i < occupied_heap_buffer_capacity; ++i) {
-            unsigned char *current_chunk = this->heap_buffer + i;
-            old_chunk = *current_chunk;
-            *current_chunk = *current_chunk << last_chunk_free_size;
-            for (unsigned char j = last_chunk_occupied_size; j < CHAR_BIT; ++j) {
-                const bit_t current_bit = (new_chunk >> j) & 1u;
-                if (current_bit == ZERO) {
-                    *current_chunk = *current_chunk & ~(1u << (j - last_chunk_occupied_size));
-                } else {
-                    *current_chunk = *current_chunk | (1u << (j - last_chunk_occupied_size));
-                }
-            }
-            new_chunk = old_chunk;
+    } else if (b_words_size > common_words_size) {
+        const size_t tail = b_words_size - common_words_size;
+        if (operation == BIT_SET_AND || operation == BIT_SET_ANDNOT) {
+            memset(words + common_words_size, 0, tail * sizeof(uint64_t));
+        } else if (words != b_words) {
+            memcpy(words + common_words_size, b_words + common_words_size, tail * sizeof(uint64_t));
+        }
+    }
+    this->size = size;
+    this->rank_index_valid = 0;
+}
+
+void bit_set_and(bit_set_t *const this, const bit_set_t *const other) {
+    bit_set_combine(this, this, other, BIT_SET_AND, "bit_set_and");
+}
+
+void bit_set_or(bit_set_t *const this, const bit_set_t *const other) {
+    bit_set_combine(this, this, other, BIT_SET_OR, "bit_set_or");
+}
+
+void bit_set_xor(bit_set_t *const this, const bit_set_t *const other) {
+    bit_set_combine(this, this, other, BIT_SET_XOR, "bit_set_xor");
+}
+
+void bit_set_andnot(bit_set_t *const this, const bit_set_t *const other) {
+    bit_set_combine(this, this, other, BIT_SET_ANDNOT, "bit_set_andnot");
+}
+
+void bit_set_and_to(bit_set_t *const this, const bit_set_t *const a, const bit_set_t *const b) {
+    bit_set_combine(this, a, b, BIT_SET_AND, "bit_set_and_to");
+}
+
+void bit_set_or_to(bit_set_t *const this, const bit_set_t *const a, const bit_set_t *const b) {
+    bit_set_combine(this, a, b, BIT_SET_OR, "bit_set_or_to");
+}
+
+void bit_set_xor_to(bit_set_t *const this, const bit_set_t *const a, const bit_set_t *const b) {
+    bit_set_combine(this, a, b, BIT_SET_XOR, "bit_set_xor_to");
+}
+
+void bit_set_andnot_to(bit_set_t *const this, const bit_set_t *const a, const bit_set_t *const b) {
+    bit_set_combine(this, a, b, BIT_SET_ANDNOT, "bit_set_andnot_to");
+}
+
+void bit_set_not_to(bit_set_t *const this, const bit_set_t *const other) {
+    if (this == NULL || other == NULL) {
+        return;
+    }
+    const size_t size = other->size;
+    if (!bit_set_reserve(this, size, "bit_set_not_to")) {
+        return;
+    }
+    const size_t words_size = bits_to_words(size);
+    uint64_t *const words = bit_set_words(this);
+    invert_words(words, bit_set_const_words(other), words_size);
+    if (size % BIT_SET_WORD_BITS) {
+        words[words_size - 1ul] &= (UINT64_C(1) << (size % BIT_SET_WORD_BITS)) - 1ul;
+    }
+    this->size = size;
+    this->rank_index_valid = 0;
+}
+
+void bit_set_not(bit_set_t *const this) {
+    bit_set_not_to(this, this);
+}
+
+[[nodiscard]] static inline unsigned int popcount_64(uint64_t word) {
+#ifdef __POPCNT__
+    return (unsigned int)__builtin_popcountll(word);
+#else
+    word -= (word >> 1) & UINT64_C(0x5555555555555555);
+    word = (word & UINT64_C(0x3333333333333333)) + ((word >> 2) & UINT64_C(0x3333333333333333));
+    word = (word + (word >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+    return (unsigned int)((word * UINT64_C(0x0101010101010101)) >> 56);
+#endif
+}
+
+// position of the set bit with the given rank, which must be below the word popcount
+[[nodiscard]] static inline unsigned int select_64(uint64_t word, unsigned int rank) {
+#ifdef __BMI2__
+    return (unsigned int)__builtin_ctzll(_pdep_u64(UINT64_C(1) << rank, word));
+#else
+    unsigned int shift = 0;
+    for (;; shift += CHAR_BIT) {
+        const unsigned int ones = popcount_64((word >> shift) & 0xffu);
+        if (rank < ones) {
+            break;
         }
+        rank -= ones;
+    }
+    word >>= shift;
+    for (; rank; --rank) {
+        word &= word - 1ul;
     }
-    // chunks and bits reverse
-    const size_t chunk_size = bits_to_chunks(this->size);
+    return shift + (unsigned int)__builtin_ctzll(word);
+#endif
+}
+
+[[nodiscard]] static size_t count_words(const uint64_t *const words, const size_t size) {
+    size_t ones = 0;
     size_t i = 0;
-    size_t j = chunk_size - 1ul;
-    while (i < j) {
-        if (i < BIT_SET_STACK_CAPACITY) {
-            unsigned char chunk_i = this->stack_buffer[i];
-            bit_set_bit_reverse(&chunk_i);
-            if (j < BIT_SET_STACK_CAPACITY) {
-                unsigned char chunk_j = this->stack_buffer[j];
-                bit_set_bit_reverse(&chunk_j);
-                this->stack_buffer[i] = chunk_j;
-                this->stack_buffer[j] = chunk_i;
-            } else {
-                const size_t j_heap = j - BIT_SET_STACK_CAPACITY;
-                unsigned char chunk_j = this->heap_buffer[j_heap];
-                bit_set_bit_reverse(&chunk_j);
-                this->stack_buffer[i] = chunk_j;
-                this->heap_buffer[j_heap] = chunk_i;
+#ifdef __AVX2__
+    // nibble lookup, byte sums folded into 64 bit lanes
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+    );
+    const __m256i nibble_256 = _mm256_set1_epi8(0x0f);
+    __m256i total_256 = _mm256_setzero_si256();
+    for (; i + 4 <= size; i += 4) {
+        const __m256i block = _mm256_loadu_si256((const __m256i *)(words + i));
+        const __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(block, nibble_256));
+        const __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble_256));
+        total_256 = _mm256_add_epi64(total_256, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+    }
+    ones += (size_t)_mm256_extract_epi64(total_256, 0) + (size_t)_mm256_extract_epi64(total_256, 1)
+        + (size_t)_mm256_extract_epi64(total_256, 2) + (size_t)_mm256_extract_epi64(total_256, 3);
+#endif
+#ifdef __SSE2__
+    // bit sliced byte counts, summed into 64 bit lanes
+    const __m128i pairs = _mm_set1_epi8(0x55);
+    const __m128i quads = _mm_set1_epi8(0x33);
+    const __m128i nibble_128 = _mm_set1_epi8(0x0f);
+    __m128i total_128 = _mm_setzero_si128();
+    for (; i + 2 <= size; i += 2) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(words + i));
+        block = _mm_sub_epi8(block, _mm_and_si128(_mm_srli_epi64(block, 1), pairs));
+        block = _mm_add_epi8(_mm_and_si128(block, quads), _mm_and_si128(_mm_srli_epi64(block, 2), quads));
+        block = _mm_and_si128(_mm_add_epi8(block, _mm_srli_epi64(block, 4)), nibble_128);
+        total_128 = _mm_add_epi64(total_128, _mm_sad_epu8(block, _mm_setzero_si128()));
+    }
+    ones += (size_t)_mm_cvtsi128_si64(total_128) + (size_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(total_128, total_128));
+#endif
+    for (; i < size; ++i) {
+        ones += popcount_64(words[i]);
+    }
+    return ones;
+}
+
+// position of the one with the given rank among the words from first on, size when there is none
+[[nodiscard]] static size_t select_words(const bit_set_t *const this, size_t first, size_t rank) {
+    const uint64_t *const words = bit_set_const_words(this);
+    const size_t words_size = bits_to_words(this->size);
+    for (; first < words_size; ++first) {
+        const unsigned int ones = popcount_64(words[first]);
+        if (rank < ones) {
+            return first * BIT_SET_WORD_BITS + select_64(words[first], (unsigned int)rank);
+        }
+        rank -= ones;
+    }
+    return this->size;
+}
+
+// O(size) pass over the words, name is the public function reported on failure
+[[nodiscard]] static unsigned char bit_set_rank_index_build(bit_set_t *const this, const char *const name) {
+    if (this->rank_index_valid) {
+        return 1;
+    }
+    const uint64_t *const words = bit_set_const_words(this);
+    const size_t words_size = bits_to_words(this->size);
+    const size_t blocks = words_size / BIT_SET_RANK_BLOCK_WORDS + !!(words_size % BIT_SET_RANK_BLOCK_WORDS);
+    size_t *const rank_index = realloc(this->rank_index, (blocks + 1ul) * sizeof(size_t));
+    if (rank_index == NULL) {
+        fprintf(stderr, "malloc NULL return in %s for rank_index_size %lu\n", name, blocks + 1ul);
+        return 0;
+    }
+    this->rank_index = rank_index;
+    size_t ones = 0;
+    for (size_t block = 0; block < blocks; ++block) {
+        rank_index[block] = ones;
+        const size_t first = block * BIT_SET_RANK_BLOCK_WORDS;
+        const size_t last = first + BIT_SET_RANK_BLOCK_WORDS < words_size ? first + BIT_SET_RANK_BLOCK_WORDS : words_size;
+        ones += count_words(words + first, last - first);
+    }
+    rank_index[blocks] = ones;
+    const size_t samples = ones / BIT_SET_SELECT_STRIDE + !!(ones % BIT_SET_SELECT_STRIDE);
+    if (samples) {
+        size_t *const select_index = realloc(this->select_index, samples * sizeof(size_t));
+        if (select_index == NULL) {
+            fprintf(stderr, "malloc NULL return in %s for select_index_size %lu\n", name, samples);
+            return 0;
+        }
+        this->select_index = select_index;
+        size_t sample = 0;
+        for (size_t block = 0; block < blocks; ++block) {
+            for (; sample < samples && sample * BIT_SET_SELECT_STRIDE < rank_index[block + 1ul]; ++sample) {
+                select_index[sample] = block;
             }
-        } else {
-            const size_t i_heap = i - BIT_SET_STACK_CAPACITY;
-            const size_t j_heap = j - BIT_SET_STACK_CAPACITY;
-            unsigned char chunk_i = this->heap_buffer[i_heap];
-            bit_set_bit_reverse(&chunk_i);
-            unsigned char chunk_j = this->heap_buffer[j_heap];
-            bit_set_bit_reverse(&chunk_j);
-            this->heap_buffer[i_heap] = chunk_j;
-            this->heap_buffer[j_heap] = chunk_i;
         }
-        ++i;
-        --j;
     }
-    // middle chunk reverse, if odd chunk size
-    if (chunk_size % 2) {
-        const size_t m = chunk_size >> 1;
-        if (m < BIT_SET_STACK_CAPACITY) {
-            bit_set_bit_reverse(this->stack_buffer + m);
+    this->rank_index_valid = 1;
+    return 1;
+}
+
+[[nodiscard]] size_t bit_set_count(const bit_set_t *const this) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    const size_t words_size = bits_to_words(this->size);
+    if (this->rank_index_valid) {
+        return this->rank_index[words_size / BIT_SET_RANK_BLOCK_WORDS + !!(words_size % BIT_SET_RANK_BLOCK_WORDS)];
+    }
+    return count_words(bit_set_const_words(this), words_size);
+}
+
+[[nodiscard]] size_t bit_set_rank(bit_set_t *const this, const size_t index) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    const uint64_t *const words = bit_set_const_words(this);
+    const size_t end = index < this->size ? index : this->size;
+    const size_t word_index = end / BIT_SET_WORD_BITS;
+    size_t rank;
+    if (bit_set_rank_index_build(this, "bit_set_rank")) {
+        const size_t block = word_index / BIT_SET_RANK_BLOCK_WORDS;
+        rank = this->rank_index[block] + count_words(words + block * BIT_SET_RANK_BLOCK_WORDS, word_index % BIT_SET_RANK_BLOCK_WORDS);
+    } else { // without an index, count from the front
+        rank = count_words(words, word_index);
+    }
+    if (end % BIT_SET_WORD_BITS) {
+        rank += popcount_64(words[word_index] & ((UINT64_C(1) << (end % BIT_SET_WORD_BITS)) - 1ul));
+    }
+    return rank;
+}
+
+[[nodiscard]] size_t bit_set_select(bit_set_t *const this, const size_t rank) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    if (!bit_set_rank_index_build(this, "bit_set_select")) { // without an index, scan from the front
+        return select_words(this, 0ul, rank);
+    }
+    const size_t words_size = bits_to_words(this->size);
+    const size_t blocks = words_size / BIT_SET_RANK_BLOCK_WORDS + !!(words_size % BIT_SET_RANK_BLOCK_WORDS);
+    if (rank >= this->rank_index[blocks]) {
+        return this->size;
+    }
+    // the block holding the one lies between the blocks of the surrounding samples,
+    // it is the last one there whose preceding count does not exceed rank
+    const size_t sample = rank / BIT_SET_SELECT_STRIDE;
+    size_t low = this->select_index[sample];
+    size_t high = (sample + 1ul) * BIT_SET_SELECT_STRIDE < this->rank_index[blocks] ? this->select_index[sample + 1ul] : blocks - 1ul;
+    while (low < high) {
+        const size_t middle = high - ((high - low) >> 1);
+        if (this->rank_index[middle] <= rank) {
+            low = middle;
         } else {
-            bit_set_bit_reverse(this->heap_buffer + m - BIT_SET_STACK_CAPACITY);
+            high = middle - 1ul;
         }
     }
+    return select_words(this, low * BIT_SET_RANK_BLOCK_WORDS, rank - this->rank_index[low]);
 }
 
 void bit_set_delete(bit_set_t *const this) {
     if (this != NULL) {
         free(this->heap_buffer);
+        free(this->rank_index);
+        free(this->select_index);
         free(this);
     }
 }
@@ -739,26 +716,12 @@ void bit_set_delete(bit_set_t *const this) {
 void bit_set_print(const bit_set_t *const this) {
     printf("[");
     if (this != NULL && this->size) {
+        const uint64_t *const words = bit_set_const_words(this);
         for (size_t i = 0; i < this->size - 1ul; ++i) {
-            const size_t current_chunk_index = i / CHAR_BIT;
-            const unsigned char *current_chunk;
-            if (current_chunk_index < BIT_SET_STACK_CAPACITY) {
-                current_chunk = this->stack_buffer + current_chunk_index;
-            } else {
-                current_chunk = this->heap_buffer + current_chunk_index - BIT_SET_STACK_CAPACITY;
-            }
-            const size_t bit_index = i % CHAR_BIT;
-            printf("%u, ", (*current_chunk >> bit_index) & 1u);
-        }
-        const size_t last_chunk_index = (this->size - 1ul) / CHAR_BIT;
-        const unsigned char *last_chunk;
-        if (last_chunk_index < BIT_SET_STACK_CAPACITY) {
-            last_chunk = this->stack_buffer + last_chunk_index;
-        } else {
-            last_chunk = this->heap_buffer + last_chunk_index - BIT_SET_STACK_CAPACITY;
+            printf("%u, ", (unsigned int)(words[i / BIT_SET_WORD_BITS] >> (i % BIT_SET_WORD_BITS)) & 1u);
         }
-        const size_t bit_index = (this->size - 1ul) % CHAR_BIT;
-        printf("%u", (*last_chunk >> bit_index) & 1u);
+        const size_t last = this->size - 1ul;
+        printf("%u", (unsigned int)(words[last / BIT_SET_WORD_BITS] >> (last % BIT_SET_WORD_BITS)) & 1u);
     }
     printf("]\n");
 }
@@ -0,0 +1,388 @@
+#include "cache.h"
+#include "list.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CACHE_WINDOW_PERCENT 1ul
+#define CACHE_SKETCH_DEPTH 4ul
+#define CACHE_SKETCH_MIN_WIDTH 16ul
+#define CACHE_SKETCH_COUNTER_MAX 15u
+#define CACHE_SKETCH_SAMPLE_FACTOR 10ul // counters are halved every width * factor additions
+#define CACHE_SKETCH_HASH_RANGE (1ul << 31)
+#define CACHE_BYTES_PER_ENTRY 64ul // sketch width estimation for byte capacity
+
+typedef struct cache_entry cache_entry_t;
+
+struct cache_entry {
+    node_data_t key;
+    node_data_t data;
+    size_t cost;
+    unsigned char window; // W-TinyLFU segment
+    max_align_t storage[]; // key and data share the entry allocation
+};
+
+struct cache {
+    hash_map_t *index; // key -> list node
+    list_t *window; // W-TinyLFU admission window, most recent first
+    list_t *main; // most recent first
+    size_t capacity;
+    size_t window_capacity;
+    size_t window_used;
+    size_t main_used;
+    size_t size;
+    cache_unit_t unit;
+    cache_policy_t policy;
+    hash_t hash_function;
+    evict_t evict;
+    unsigned char *sketch; // count-min sketch of access frequencies
+    size_t sketch_width;
+    size_t sketch_additions;
+    cache_stats_t stats;
+};
+
+static const unsigned long long cache_sketch_seeds[CACHE_SKETCH_DEPTH] = {
+    0x9e3779b97f4a7c15ull,
+    0xc2b2ae3d27d4eb4full,
+    0x165667b19e3779f9ull,
+    0xd6e8feb86659fd93ull
+};
+
+[[nodiscard]] cache_t *cache_init(
+    const size_t capacity,
+    const cache_unit_t unit,
+    const cache_policy_t policy,
+    const hash_t hash_function,
+    const comparator_t key_comparator,
+    const evict_t evict
+) {
+    if (hash_function == NULL || key_comparator == NULL) {
+        return NULL;
+    }
+    cache_t *const c = malloc(sizeof(cache_t));
+    if (c == NULL) {
+        fprintf(stderr, "malloc NULL return in cache_init\n");
+        return c;
+    }
+    c->index = hash_map_init(0ul, hash_function, key_comparator);
+    c->window = list_init();
+    c->main = list_init();
+    c->sketch = NULL;
+    c->sketch_width = 0ul;
+    c->sketch_additions = 0ul;
+    if (c->index == NULL || c->window == NULL || c->main == NULL) {
+        fprintf(stderr, "malloc NULL return in cache_init for index\n");
+        cache_delete(c);
+        return NULL;
+    }
+    c->capacity = capacity;
+    c->window_capacity = 0ul;
+    c->window_used = 0ul;
+    c->main_used = 0ul;
+    c->size = 0ul;
+    c->unit = unit;
+    c->policy = policy;
+    c->hash_function = hash_function;
+    c->evict = evict;
+    c->stats.hits = 0ul;
+    c->stats.misses = 0ul;
+    c->stats.evictions = 0ul;
+    if (policy == CACHE_TINY_LFU) {
+        c->window_capacity = capacity * CACHE_WINDOW_PERCENT / 100ul;
+        if (c->window_capacity == 0ul) {
+            c->window_capacity = capacity < 1ul ? capacity : 1ul;
+        }
+        const size_t entries = unit == CACHE_ENTRIES ? capacity : capacity / CACHE_BYTES_PER_ENTRY;
+        size_t sketch_width = CACHE_SKETCH_MIN_WIDTH;
+        while (sketch_width < entries) {
+            sketch_width <<= 1;
+        }
+        c->sketch = calloc(CACHE_SKETCH_DEPTH * sketch_width, sizeof(unsigned char));
+        if (c->sketch == NULL) {
+            fprintf(stderr, "malloc NULL return in cache_init for sketch width %lu\n", sketch_width);
+            cache_delete(c);
+            return NULL;
+        }
+        c->sketch_width = sketch_width;
+    }
+    return c;
+}
+
+[[nodiscard]] size_t cache_size(const cache_t *const this) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    return this->size;
+}
+
+[[nodiscard]] static size_t cache_sketch_index(
+    const cache_t *const this,
+    const size_t key_hash,
+    const size_t row
+) {
+    const unsigned long long mixed = ((unsigned long long)key_hash + 1ull) * cache_sketch_seeds[row];
+    return row * this->sketch_width + ((mixed >> 32) & (this->sketch_width - 1ul));
+}
+
+static void cache_sketch_increment(
+    cache_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    const size_t key_hash = this->hash_function(CACHE_SKETCH_HASH_RANGE, key_sz, key);
+    for (size_t row = 0ul; row < CACHE_SKETCH_DEPTH; ++row) {
+        unsigned char *const counter = this->sketch + cache_sketch_index(this, key_hash, row);
+        if (*counter < CACHE_SKETCH_COUNTER_MAX) {
+            ++*counter;
+        }
+    }
+    if (++this->sketch_additions >= this->sketch_width * CACHE_SKETCH_SAMPLE_FACTOR) { // aging
+        for (size_t i = 0ul; i < CACHE_SKETCH_DEPTH * this->sketch_width; ++i) {
+            this->sketch[i] >>= 1;
+        }
+        this->sketch_additions >>= 1;
+    }
+}
+
+[[nodiscard]] static unsigned char cache_sketch_frequency(
+    const cache_t *const restrict this,
+    const node_data_t *const restrict key
+) {
+    const size_t key_hash = this->hash_function(CACHE_SKETCH_HASH_RANGE, key->type_sz, key->data);
+    unsigned char frequency = CACHE_SKETCH_COUNTER_MAX;
+    for (size_t row = 0ul; row < CACHE_SKETCH_DEPTH; ++row) {
+        const unsigned char counter = this->sketch[cache_sketch_index(this, key_hash, row)];
+        if (counter < frequency) {
+            frequency = counter;
+        }
+    }
+    return frequency;
+}
+
+[[nodiscard]] static size_t cache_cost(
+    const cache_t *const this,
+    const size_t key_sz,
+    const size_t data_sz
+) {
+    return this->unit == CACHE_ENTRIES ? 1ul : key_sz + data_sz;
+}
+
+[[nodiscard]] static cache_entry_t *cache_entry_init(
+    const size_t key_sz,
+    const void *const restrict key,
+    const size_t data_sz,
+    const void *const restrict data
+) {
+    const size_t key_storage_sz = (key_sz + sizeof(max_align_t) - 1ul) / sizeof(max_align_t) * sizeof(max_align_t);
+    cache_entry_t *const entry = malloc(sizeof(cache_entry_t) + key_storage_sz + data_sz);
+    if (entry == NULL) {
+        fprintf(stderr, "malloc NULL return in cache_entry_init for key_sz %lu and data_sz %lu\n", key_sz, data_sz);
+        return NULL;
+    }
+    entry->key.type_sz = key_sz;
+    entry->key.data = entry->storage;
+    memcpy(entry->key.data, key, key_sz);
+    entry->data.type_sz = data_sz;
+    entry->data.data = (unsigned char*)entry->storage + key_storage_sz;
+    memcpy(entry->data.data, data, data_sz);
+    return entry;
+}
+
+static void cache_forget(
+    cache_t *const this,
+    list_node_t *const node
+) {
+    cache_entry_t *const entry = list_node_data(node)->data;
+    hash_map_remove(this->index, entry->key.type_sz, entry->key.data, 1);
+    if (entry->window) {
+        this->window_used -= entry->cost;
+        list_node_remove(this->window, node, 1);
+    } else {
+        this->main_used -= entry->cost;
+        list_node_remove(this->main, node, 1);
+    }
+    --this->size;
+    free(entry);
+}
+
+static void cache_evict(
+    cache_t *const this,
+    list_node_t *const node
+) {
+    const cache_entry_t *const entry = list_node_data(node)->data;
+    ++this->stats.evictions;
+    if (this->evict != NULL) {
+        this->evict(&entry->key, &entry->data);
+    }
+    cache_forget(this, node);
+}
+
+static void cache_balance(cache_t *const this) {
+    if (this->policy == CACHE_LRU) {
+        while (this->main_used > this->capacity) {
+            cache_evict(this, list_tail(this->main));
+        }
+        return;
+    }
+    const size_t main_capacity = this->capacity - this->window_capacity;
+    while (this->window_used > this->window_capacity) {
+        // window victim becomes a candidate for the main segment
+        list_node_t *const candidate = list_tail(this->window);
+        cache_entry_t *const candidate_entry = list_node_data(candidate)->data;
+        list_node_transfer(this->window, candidate, this->main);
+        candidate_entry->window = 0;
+        this->window_used -= candidate_entry->cost;
+        this->main_used += candidate_entry->cost;
+        const unsigned char candidate_frequency = cache_sketch_frequency(this, &candidate_entry->key);
+        unsigned char pending = 1;
+        while (this->main_used > main_capacity) {
+            list_node_t *const victim = list_tail(this->main);
+            if (pending && victim != candidate) {
+                const cache_entry_t *const victim_entry = list_node_data(victim)->data;
+                pending = 0;
+                if (candidate_frequency <= cache_sketch_frequency(this, &victim_entry->key)) { // admission rejected
+                    cache_evict(this, candidate);
+                    continue;
+                }
+            }
+            if (victim == candidate) {
+                pending = 0;
+            }
+            cache_evict(this, victim);
+        }
+    }
+}
+
+[[nodiscard]] node_data_t *cache_at(
+    cache_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    if (this == NULL) {
+        return NULL;
+    }
+    if (this->policy == CACHE_TINY_LFU) {
+        cache_sketch_increment(this, key_sz, key);
+    }
+    const node_data_t *const index_at = hash_map_at(this->index, key_sz, key);
+    if (index_at == NULL) {
+        ++this->stats.misses;
+        return NULL;
+    }
+    ++this->stats.hits;
+    list_node_t *const node = index_at->data;
+    cache_entry_t *const entry = list_node_data(node)->data;
+    list_node_move_to_head(entry->window ? this->window : this->main, node);
+    return &entry->data;
+}
+
+void cache_insert(
+    cache_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key,
+    const size_t data_sz,
+    const void *const restrict data
+) {
+    if (this == NULL) {
+        return;
+    }
+    const size_t cost = cache_cost(this, key_sz, data_sz);
+    if (cost > this->capacity) { // never fits, a present value is stale after this
+        const node_data_t *const index_at = hash_map_at(this->index, key_sz, key);
+        if (index_at != NULL) {
+            cache_forget(this, index_at->data);
+        }
+        return;
+    }
+    if (this->policy == CACHE_TINY_LFU) {
+        cache_sketch_increment(this, key_sz, key);
+    }
+    const node_data_t *const index_at = hash_map_at(this->index, key_sz, key);
+    if (index_at != NULL) { // already present -> reassigning
+        list_node_t *const node = index_at->data;
+        cache_entry_t *const entry = list_node_data(node)->data;
+        if (entry->data.type_sz == data_sz) {
+            memcpy(entry->data.data, data, data_sz);
+            list_node_move_to_head(entry->window ? this->window : this->main, node);
+            return;
+        }
+        cache_forget(this, node);
+    }
+    cache_entry_t *const entry = cache_entry_init(key_sz, key, data_sz, data);
+    if (entry == NULL) {
+        return;
+    }
+    entry->cost = cost;
+    entry->window = this->policy == CACHE_TINY_LFU;
+    list_t *const segment = entry->window ? this->window : this->main;
+    const list_node_t *const prev_head = list_head(segment);
+    list_push_front(segment, sizeof(cache_entry_t), entry, 1);
+    list_node_t *const node = list_head(segment);
+    if (node == prev_head || list_node_data(node)->data != entry) { // push failed
+        free(entry);
+        return;
+    }
+    hash_map_insert(this->index, key_sz, entry->key.data, sizeof(list_node_t*), node, 1);
+    const node_data_t *const inserted_at = hash_map_at(this->index, key_sz, entry->key.data);
+    if (inserted_at == NULL || inserted_at->data != node) { // index insertion failed
+        list_node_remove(segment, node, 1);
+        free(entry);
+        return;
+    }
+    if (entry->window) {
+        this->window_used += cost;
+    } else {
+        this->main_used += cost;
+    }
+    ++this->size;
+    cache_balance(this);
+}
+
+void cache_remove(
+    cache_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    if (this == NULL) {
+        return;
+    }
+    const node_data_t *const index_at = hash_map_at(this->index, key_sz, key);
+    if (index_at != NULL) {
+        cache_forget(this, index_at->data);
+    }
+}
+
+[[nodiscard]] cache_stats_t cache_stats(const cache_t *const this) {
+    cache_stats_t stats = {
+        .hits = 0ul,
+        .misses = 0ul,
+        .evictions = 0ul
+    };
+    if (this == NULL) {
+        return stats;
+    }
+    return this->stats;
+}
+
+void cache_delete(cache_t *const this) {
+    if (this == NULL) {
+        return;
+    }
+    list_t *const segments[] = {this->window, this->main};
+    for (size_t i = 0ul; i < sizeof(segments) / sizeof(*segments); ++i) {
+        if (segments[i] == NULL) {
+            continue;
+        }
+        for (list_node_t *node = list_head(segments[i]); node != NULL; node = list_head(segments[i])) {
+            free(list_node_data(node)->data);
+            list_node_remove(segments[i], node, 1);
+        }
+        list_delete(segments[i], 1);
+    }
+    if (this->index != NULL) {
+        hash_map_delete(this->index, 1);
+    }
+    free(this->sketch);
+    free(this);
+}
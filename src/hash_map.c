@@ -1,25 +1,63 @@
 #include "hash_map.h"
+#include "hash_map_chain.h"
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#define LOAD_FACTOR_MAX 0.75l
-#define LOAD_FACTOR_MIN 0.25l
 #define HASH_MAP_STACK_CAPACITY 1ul
 #define HASH_MAP_MIN_CAPACITY (2ul)
-#define HASH_MOD(capacity) ((capacity) * 86ul / 100ul)
+#define HASH_MAP_IMAGE_MAGIC "HASHMAP"
+#define HASH_MAP_IMAGE_VERSION 1ull
+#define HASH_MAP_IMAGE_ALIGNMENT 16ul
 
 struct bucket {
     node_data_t key;
     node_data_t data;
-    bucket_t *next; // coalesced hashing
+    size_t next; // bucket index + 1, 0 for chain end (coalesced hashing)
+};
+
+struct hash_map_image_header {
+    char magic[8];
+    unsigned long long version;
+    unsigned long long capacity;
+    unsigned long long size;
+    unsigned long long buckets_offset;
+    unsigned long long blob_offset;
+    unsigned long long image_size;
+};
+
+struct hash_map_image_bucket {
+    unsigned long long key_offset; // 0 for empty bucket
+    unsigned long long key_sz;
+    unsigned long long data_offset;
+    unsigned long long data_sz;
+    unsigned long long next; // bucket index + 1, 0 for chain end
+};
+
+typedef struct hash_map_image_header hash_map_image_header_t;
+typedef struct hash_map_image_bucket hash_map_image_bucket_t;
+
+struct hash_map_mmap {
+    void *image;
+    size_t image_size;
+    const hash_map_image_bucket_t *buckets;
+    size_t capacity;
+    size_t size;
+    hash_t hash_function;
+    comparator_t key_comparator;
 };
 
 struct hash_map {
     bucket_t stack_buffer[HASH_MAP_STACK_CAPACITY]; // Small Object Optimization
     bucket_t *heap_buffer;
     size_t heap_buffer_capacity;
+    size_t size;
+    size_t free_cursor; // free bucket lookup position, moves towards the beginning
     hash_t hash_function;
     comparator_t key_comparator;
 };
@@ -39,13 +77,14 @@ struct hash_map {
     }
     hm->hash_function = hash_function;
     hm->key_comparator = key_comparator;
+    hm->size = 0ul;
     for (size_t i = 0ul; i < HASH_MAP_STACK_CAPACITY; ++i) {
         bucket_t *const b = hm->stack_buffer + i;
         b->key.data = NULL;
         b->key.type_sz = 0;
         b->data.data = NULL;
         b->data.type_sz = 0ul;
-        b->next = NULL;
+        b->next = 0ul;
     }
     bucket_t *heap_buffer = NULL;
     size_t heap_buffer_capacity = 0ul;
@@ -59,6 +98,7 @@ struct hash_map {
             fprintf(stderr, "malloc NULL return in hash_map_init for capacity %lu\n", capacity);
             hm->heap_buffer = NULL;
             hm->heap_buffer_capacity = 0ul;
+            hm->free_cursor = HASH_MAP_STACK_CAPACITY;
             return hm;
         }
         for (size_t i = 0ul; i < heap_buffer_capacity; ++i) {
@@ -67,32 +107,69 @@ struct hash_map {
             b->key.type_sz = 0;
             b->data.data = NULL;
             b->data.type_sz = 0ul;
-            b->next = NULL;
+            b->next = 0ul;
         }
     }
     hm->heap_buffer = heap_buffer;
     hm->heap_buffer_capacity = heap_buffer_capacity;
+    hm->free_cursor = HASH_MAP_STACK_CAPACITY + heap_buffer_capacity;
     return hm;
 }
 
 [[nodiscard]] size_t hash_map_size(const hash_map_t *const this) {
-    if (this == NULL || this->heap_buffer_capacity == 0ul) {
+    if (this == NULL) {
         return 0;
     }
-    size_t size = 0ul;
-    for (size_t i = 0ul; i < HASH_MAP_STACK_CAPACITY; ++i) {
-        const bucket_t *const b = this->stack_buffer + i;
-        if (b->key.data != NULL) {
-            ++size;
-        }
-    }
-    for (size_t i = 0ul; i < this->heap_buffer_capacity; ++i) {
-        const bucket_t *const b = this->heap_buffer + i;
-        if (b->key.data != NULL) {
-            ++size;
-        }
+    return this->size;
+}
+
+[[nodiscard]] static bucket_t *hash_map_bucket(
+    const hash_map_t *const this,
+    const size_t index
+) {
+    assert(index < HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity);
+    if (index < HASH_MAP_STACK_CAPACITY) {
+        return (bucket_t*)this->stack_buffer + index;
     }
-    return size;
+    return this->heap_buffer + index - HASH_MAP_STACK_CAPACITY;
+}
+
+[[nodiscard]] static size_t hash_map_capacity(const hash_map_t *const this) {
+    return HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
+}
+
+[[nodiscard]] static unsigned char hash_map_occupied(const bucket_t *const b) {
+    return b->key.data != NULL;
+}
+
+[[nodiscard]] static size_t hash_map_home(
+    const hash_map_t *const restrict this,
+    const bucket_t *const restrict b
+) {
+    return this->hash_function(HASH_MAP_MOD(hash_map_capacity(this)), b->key.type_sz, b->key.data);
+}
+
+static void hash_map_clear(bucket_t *const b) {
+    b->key.data = NULL;
+    b->key.type_sz = 0;
+    b->data.data = NULL;
+    b->data.type_sz = 0ul;
+}
+
+HASH_MAP_CHAIN_DEFINE(hash_map, hash_map_t, bucket_t)
+
+static void hash_map_place(
+    hash_map_t *const this,
+    const node_data_t key,
+    const node_data_t data
+) {
+    // key is known to be absent, no lookup or copy
+    const size_t capacity = hash_map_capacity(this);
+    bucket_t *const b = hash_map_link(this, this->hash_function(HASH_MAP_MOD(capacity), key.type_sz, key.data));
+    assert(b != NULL);
+    b->key = key;
+    b->data = data;
+    ++this->size;
 }
 
 static void hash_map_rehash(
@@ -100,160 +177,46 @@ static void hash_map_rehash(
     const size_t capacity
 ) {
     assert(this != NULL && capacity != 0ul);
-    bucket_t stack_buffer[HASH_MAP_STACK_CAPACITY];
+    hash_map_t rehashed = *this;
+    rehashed.size = 0ul;
+    rehashed.free_cursor = capacity;
+    rehashed.heap_buffer = NULL;
+    rehashed.heap_buffer_capacity = 0ul;
     for (size_t i = 0ul; i < HASH_MAP_STACK_CAPACITY; ++i) {
-        bucket_t *const b = stack_buffer + i;
+        bucket_t *const b = rehashed.stack_buffer + i;
         b->key.data = NULL;
         b->key.type_sz = 0;
         b->data.data = NULL;
         b->data.type_sz = 0;
-        b->next = NULL;
+        b->next = 0ul;
     }
     if (capacity > HASH_MAP_STACK_CAPACITY) { // both stack and heap reallocation required
         const size_t heap_buffer_capacity = capacity - HASH_MAP_STACK_CAPACITY;
         bucket_t *const heap_buffer = calloc(heap_buffer_capacity, sizeof(bucket_t));
+        if (heap_buffer == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_map_rehash for capacity %lu\n", capacity);
+            return;
+        }
         for (size_t i = 0ul; i < heap_buffer_capacity; ++i) {
             bucket_t *const b = heap_buffer + i;
             b->key.data = NULL;
             b->key.type_sz = 0;
             b->data.data = NULL;
             b->data.type_sz = 0;
-            b->next = NULL;
-        }
-        for (size_t i = 0ul; i < HASH_MAP_STACK_CAPACITY; ++i) {
-            const bucket_t *const b = this->stack_buffer + i;
-            if (b->key.data != NULL) {
-                const size_t key_hash = this->hash_function(HASH_MOD(capacity), b->key.type_sz, b->key.data);
-                bucket_t *prev_bucket;
-                if (key_hash < HASH_MAP_STACK_CAPACITY) {
-                    prev_bucket = stack_buffer + key_hash;
-                } else {
-                    prev_bucket = heap_buffer + key_hash - HASH_MAP_STACK_CAPACITY;
-                }
-                if (prev_bucket->key.data == NULL) { // no collision
-                    prev_bucket->key = b->key;
-                    prev_bucket->data = b->data;
-                    prev_bucket->next = NULL;
-                    continue;
-                }
-                // collision
-                while (prev_bucket->next != NULL) {
-                    prev_bucket = prev_bucket->next;
-                }
-                bucket_t *new_bucket = heap_buffer + heap_buffer_capacity - 1ul;
-                size_t heap_buffer_decrements = 0ul;
-                while (new_bucket->key.data != NULL && ++heap_buffer_decrements < heap_buffer_capacity) {
-                    --new_bucket;
-                }
-                if (new_bucket->key.data != NULL) {
-                    new_bucket = stack_buffer + HASH_MAP_STACK_CAPACITY - 1ul;
-                    while (new_bucket->key.data != NULL) {
-                        --new_bucket;
-                    }
-                }
-                new_bucket->key = b->key;
-                new_bucket->data = b->data;
-                new_bucket->next = NULL;
-                prev_bucket->next = new_bucket;
-            }
-        }
-        for (size_t i = 0ul; i < this->heap_buffer_capacity; ++i) {
-            const bucket_t *const b = this->heap_buffer + i;
-            if (b->key.data != NULL) {
-                const size_t key_hash = this->hash_function(HASH_MOD(capacity), b->key.type_sz, b->key.data);
-                bucket_t *prev_bucket;
-                if (key_hash < HASH_MAP_STACK_CAPACITY) {
-                    prev_bucket = stack_buffer + key_hash;
-                } else {
-                    prev_bucket = heap_buffer + key_hash - HASH_MAP_STACK_CAPACITY;
-                }
-                if (prev_bucket->key.data == NULL) { // no collision
-                    prev_bucket->key = b->key;
-                    prev_bucket->data = b->data;
-                    prev_bucket->next = NULL;
-                    continue;
-                }
-                // collision
-                while (prev_bucket->next != NULL) {
-                    prev_bucket = prev_bucket->next;
-                }
-                bucket_t *new_bucket = heap_buffer + heap_buffer_capacity - 1ul;
-                size_t heap_buffer_decrements = 0ul;
-                while (new_bucket->key.data != NULL && ++heap_buffer_decrements < heap_buffer_capacity) {
-                    --new_bucket;
-                }
-                if (new_bucket->key.data != NULL) {
-                    new_bucket = stack_buffer + HASH_MAP_STACK_CAPACITY - 1ul;
-                    while (new_bucket->key.data != NULL) {
-                        --new_bucket;
-                    }
-                }
-                new_bucket->key = b->key;
-                new_bucket->data = b->data;
-                new_bucket->next = NULL;
-                prev_bucket->next = new_bucket;
-            }
+            b->next = 0ul;
         }
-        memcpy(this->stack_buffer, stack_buffer, HASH_MAP_STACK_CAPACITY * sizeof(bucket_t));
-        free(this->heap_buffer);
-        this->heap_buffer = heap_buffer;
-        this->heap_buffer_capacity = heap_buffer_capacity;
-    } else { // stack reallocation only
-        for (size_t i = 0ul; i < HASH_MAP_STACK_CAPACITY; ++i) {
-            const bucket_t *const b = this->stack_buffer + i;
-            if (b->key.data != NULL) {
-                const size_t key_hash = this->hash_function(HASH_MOD(capacity), b->key.type_sz, b->key.data);
-                bucket_t *prev_bucket = stack_buffer + key_hash;
-                if (prev_bucket->key.data == NULL) { // no collision
-                    prev_bucket->key = b->key;
-                    prev_bucket->data = b->data;
-                    prev_bucket->next = NULL;
-                    continue;
-                }
-                // collision
-                while (prev_bucket->next != NULL) {
-                    prev_bucket = prev_bucket->next;
-                }
-                bucket_t *new_bucket = stack_buffer + HASH_MAP_STACK_CAPACITY - 1ul;
-                while (new_bucket->key.data != NULL) {
-                    --new_bucket;
-                }
-                new_bucket->key = b->key;
-                new_bucket->data = b->data;
-                new_bucket->next = NULL;
-                prev_bucket->next = new_bucket;
-            }
-        }
-        for (size_t i = 0ul; i < this->heap_buffer_capacity; ++i) {
-            const bucket_t *const b = this->heap_buffer + i;
-            if (b->key.data != NULL) {
-                const size_t key_hash = this->hash_function(HASH_MOD(capacity), b->key.type_sz, b->key.data);
-                bucket_t *prev_bucket = stack_buffer + key_hash;
-                if (prev_bucket->key.data == NULL) { // no collision
-                    prev_bucket->key = b->key;
-                    prev_bucket->data = b->data;
-                    prev_bucket->next = NULL;
-                    continue;
-                }
-                // collision
-                while (prev_bucket->next != NULL) {
-                    prev_bucket = prev_bucket->next;
-                }
-                bucket_t *new_bucket = stack_buffer + HASH_MAP_STACK_CAPACITY - 1ul;
-                while (new_bucket->key.data != NULL) {
-                    --new_bucket;
-                }
-                new_bucket->key = b->key;
-                new_bucket->data = b->data;
-                new_bucket->next = NULL;
-                prev_bucket->next = new_bucket;
-            }
+        rehashed.heap_buffer = heap_buffer;
+        rehashed.heap_buffer_capacity = heap_buffer_capacity;
+    }
+    const size_t old_capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    for (size_t i = 0ul; i < old_capacity; ++i) {
+        const bucket_t *const b = hash_map_bucket(this, i);
+        if (b->key.data != NULL) {
+            hash_map_place(&rehashed, b->key, b->data);
         }
-        memcpy(this->stack_buffer, stack_buffer, HASH_MAP_STACK_CAPACITY * sizeof(bucket_t));
-        free(this->heap_buffer);
-        this->heap_buffer = NULL;
-        this->heap_buffer_capacity = 0ul;
     }
+    free(this->heap_buffer);
+    *this = rehashed;
 }
 
 [[nodiscard]] static bucket_t *hash_map_bucket_at(
@@ -263,24 +226,21 @@ static void hash_map_rehash(
 ) {
     const size_t capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
     assert(this != NULL && capacity != 0ul);
-    const size_t key_hash = this->hash_function(HASH_MOD(capacity), key_sz, key);
-    bucket_t *b;
-    if (key_hash < HASH_MAP_STACK_CAPACITY) {
-        b = (bucket_t*)this->stack_buffer + key_hash;
-    } else {
-        b = this->heap_buffer + key_hash - HASH_MAP_STACK_CAPACITY;
-    }
+    const size_t key_hash = this->hash_function(HASH_MAP_MOD(capacity), key_sz, key);
+    bucket_t *b = hash_map_bucket(this, key_hash);
     if (b->key.data == NULL) {
         return NULL;
     }
-    do {
+    for (;;) {
         const unsigned char key_comparison_result = this->key_comparator(key, b->key.data);
         if (key_comparison_result == 0) { // key == b->key
             return b;
         }
-        b = b->next;
-    } while (b != NULL);
-    return NULL;
+        if (b->next == 0ul) {
+            return NULL;
+        }
+        b = hash_map_bucket(this, b->next - 1ul);
+    }
 }
 
 [[nodiscard]] node_data_t *hash_map_at(
@@ -288,8 +248,7 @@ static void hash_map_rehash(
     const size_t key_sz,
     const void *const restrict key
 ) {
-    const size_t capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
-    if (this == NULL || capacity == 0ul) {
+    if (this == NULL || this->size == 0ul) {
         return NULL;
     }
     bucket_t *const bucket_at = hash_map_bucket_at(this, key_sz, key);
@@ -307,99 +266,56 @@ void hash_map_insert(
     const void *const restrict data,
     const unsigned char intrusive
 ) {
-    // rehash
-    size_t capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
-    if (capacity > 0ul) {
-        const size_t occupied_size = hash_map_size(this);
-        const long double load_factor = (long double)occupied_size / (long double)capacity;
-        if (load_factor > LOAD_FACTOR_MAX) {
-            capacity = (capacity + 1ul) << 1;
-            hash_map_rehash(this, capacity);
-        }
-    } else { // first allocation
-        assert(this->heap_buffer == NULL);
-        bucket_t *const heap_buffer = calloc(HASH_MAP_MIN_CAPACITY, sizeof(bucket_t));
-        if (heap_buffer == NULL) {
-            fprintf(stderr, "malloc NULL return in hash_map_insert for capacity %lu\n", HASH_MAP_MIN_CAPACITY);
-            return;
-        }
-        for (size_t i = 0ul; i < HASH_MAP_MIN_CAPACITY; ++i) {
-            bucket_t *const b = heap_buffer + i;
-            b->key.data = NULL;
-            b->key.type_sz = 0;
-            b->data.data = NULL;
-            b->data.type_sz = 0ul;
-            b->next = NULL;
-        }
-        this->heap_buffer = heap_buffer;
-        this->heap_buffer_capacity = HASH_MAP_MIN_CAPACITY;
+    if (this == NULL) {
+        return;
     }
-    // insertion
-    const size_t key_hash = this->hash_function(HASH_MOD(capacity), key_sz, key);
-    bucket_t *b;
-    if (key_hash < HASH_MAP_STACK_CAPACITY) {
-        b = this->stack_buffer + key_hash;
-    } else {
-        b = this->heap_buffer + key_hash - HASH_MAP_STACK_CAPACITY;
-    }
-    if (b->key.data == NULL) { // not present (no collision) -> new
+    // reassignment
+    bucket_t *const b = this->size != 0ul ? hash_map_bucket_at(this, key_sz, key) : NULL;
+    if (b != NULL) { // already present -> reassigning
         if (intrusive) {
-            b->key.data = (void*)key;
             b->data.data = (void*)data;
         } else {
-            b->key.data = malloc(key_sz);
-            memcpy(b->key.data, key, key_sz);
-            b->data.data = malloc(data_sz);
-            memcpy(b->data.data, data, data_sz);
-        }
-        b->key.type_sz = key_sz;
-        b->data.type_sz = data_sz;
-        b->next = NULL;
-        return;
-    }
-    // collision or reassignment
-    bucket_t *prev_bucket;
-    do {
-        const unsigned char key_comparison_result = this->key_comparator(key, b->key.data);
-        if (key_comparison_result == 0) { // key == b->key
-            // already present -> reassigning
             if (b->data.type_sz != data_sz) {
                 free(b->data.data);
                 void *const new_data = malloc(data_sz);
                 b->data.data = new_data;
-                b->data.type_sz = data_sz;
             }
             memcpy(b->data.data, data, data_sz);
-            return;
         }
-        prev_bucket = b;
-        b = b->next;
-    } while (b != NULL);
-    // collision
-    bucket_t *new_bucket = this->heap_buffer + this->heap_buffer_capacity - 1ul;
-    size_t heap_buffer_decrements = 0ul;
-    while (new_bucket->key.data != NULL && ++heap_buffer_decrements < this->heap_buffer_capacity) {
-        --new_bucket;
-    }
-    if (new_bucket->key.data != NULL) {
-        new_bucket = this->stack_buffer + HASH_MAP_STACK_CAPACITY - 1ul;
-        while (new_bucket->key.data != NULL) {
-            --new_bucket;
+        b->data.type_sz = data_sz;
+        return;
+    }
+    // rehash
+    const size_t capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    const long double load_factor = (long double)(this->size + 1ul) / (long double)capacity;
+    if (load_factor > HASH_MAP_LOAD_FACTOR_MAX) {
+        hash_map_rehash(this, (capacity + 1ul) << 1);
+        if (this->size + 1ul > HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity) {
+            return;
         }
     }
-    if (intrusive) {
-        new_bucket->key.data = (void*)key;
-        new_bucket->data.data = (void*)data;
-    } else {
-        new_bucket->key.data = malloc(key_sz);
-        memcpy(new_bucket->key.data, key, key_sz);
-        new_bucket->data.data = malloc(data_sz);
-        memcpy(new_bucket->data.data, data, data_sz);
+    // insertion
+    node_data_t new_key = {
+        .type_sz = key_sz,
+        .data = (void*)key
+    };
+    node_data_t new_data = {
+        .type_sz = data_sz,
+        .data = (void*)data
+    };
+    if (!intrusive) {
+        new_key.data = malloc(key_sz);
+        new_data.data = malloc(data_sz);
+        if (new_key.data == NULL || new_data.data == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_map_insert for key_sz %lu and data_sz %lu\n", key_sz, data_sz);
+            free(new_key.data);
+            free(new_data.data);
+            return;
+        }
+        memcpy(new_key.data, key, key_sz);
+        memcpy(new_data.data, data, data_sz);
     }
-    new_bucket->key.type_sz = key_sz;
-    new_bucket->data.type_sz = data_sz;
-    new_bucket->next = NULL;
-    prev_bucket->next = new_bucket;
+    hash_map_place(this, new_key, new_data);
 }
 
 void hash_map_remove(
@@ -408,54 +324,43 @@ void hash_map_remove(
     const void *const restrict key,
     const unsigned char intrusive
 ) {
-    size_t capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
-    if (this == NULL || capacity == 0ul) {
+    if (this == NULL || this->size == 0ul) {
         return;
     }
-    const size_t key_hash = this->hash_function(HASH_MOD(capacity), key_sz, key);
-    bucket_t *b;
-    if (key_hash < HASH_MAP_STACK_CAPACITY) {
-        b = this->stack_buffer + key_hash;
-    } else {
-        b = this->heap_buffer + key_hash - HASH_MAP_STACK_CAPACITY;
-    }
+    size_t capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    const size_t key_hash = this->hash_function(HASH_MAP_MOD(capacity), key_sz, key);
+    bucket_t *b = hash_map_bucket(this, key_hash);
     if (b->key.data == NULL) { // not present -> exit
         return;
     }
     // lookup
     bucket_t *prev_bucket = NULL;
-    do {
-        const unsigned char key_comparison_result = this->key_comparator(key, b->key.data);
-        if (key_comparison_result == 0) { // key == b->key
-            // present -> removing
-            if (!intrusive) {
-                free(b->key.data);
-                free(b->data.data);
-            }
-            if (prev_bucket != NULL) {
-                prev_bucket->next = b->next;
-            }
-            b->key.data = NULL;
-            b->key.type_sz = 0;
-            b->data.data = NULL;
-            b->data.type_sz = 0ul;
-            b->next = NULL;
-            // rehash
-            const size_t occupied_size = hash_map_size(this);
-            const long double load_factor = (long double)occupied_size / (long double)capacity;
-            if (load_factor < LOAD_FACTOR_MIN && capacity > HASH_MAP_MIN_CAPACITY) {
-                capacity >>= 1;
-                if (capacity < HASH_MAP_MIN_CAPACITY) {
-                    capacity = HASH_MAP_MIN_CAPACITY;
-                }
-                hash_map_rehash(this, capacity);
-            }
+    while (this->key_comparator(key, b->key.data) != 0) {
+        if (b->next == 0ul) { // not present -> exit
             return;
         }
         prev_bucket = b;
-        b = b->next;
-    } while (b != NULL);
-    // not present -> exit
+        b = hash_map_bucket(this, b->next - 1ul);
+    }
+    // present -> removing
+    const bucket_t removed = *b;
+    if (!hash_map_unlink(this, prev_bucket, b)) {
+        return;
+    }
+    if (!intrusive) {
+        free(removed.key.data);
+        free(removed.data.data);
+    }
+    --this->size;
+    // rehash
+    const long double load_factor = (long double)this->size / (long double)capacity;
+    if (load_factor < HASH_MAP_LOAD_FACTOR_MIN && capacity > HASH_MAP_MIN_CAPACITY) {
+        capacity >>= 1;
+        if (capacity < HASH_MAP_MIN_CAPACITY) {
+            capacity = HASH_MAP_MIN_CAPACITY;
+        }
+        hash_map_rehash(this, capacity);
+    }
 }
 
 void hash_map_delete(
@@ -518,6 +423,230 @@ void hash_map_print(
     printf("}\n");
 }
 
+// snapshot image: header | buckets | blob, offsets are relative to the image start
+
+[[nodiscard]] static size_t hash_map_image_align(const size_t offset) {
+    return (offset + HASH_MAP_IMAGE_ALIGNMENT - 1ul) / HASH_MAP_IMAGE_ALIGNMENT * HASH_MAP_IMAGE_ALIGNMENT;
+}
+
+unsigned char hash_map_save(
+    const hash_map_t *const restrict this,
+    const char *const restrict path
+) {
+    if (this == NULL || path == NULL) {
+        return 0;
+    }
+    FILE *const file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "fopen NULL return in hash_map_save for path %s\n", path);
+        return 0;
+    }
+    const size_t capacity = HASH_MAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    const size_t buckets_offset = hash_map_image_align(sizeof(hash_map_image_header_t));
+    const size_t blob_offset = hash_map_image_align(buckets_offset + capacity * sizeof(hash_map_image_bucket_t));
+    size_t image_size = blob_offset;
+    for (size_t i = 0ul; i < capacity; ++i) {
+        const bucket_t *const b = hash_map_bucket(this, i);
+        if (b->key.data != NULL) {
+            image_size = hash_map_image_align(image_size + b->key.type_sz);
+            image_size = hash_map_image_align(image_size + b->data.type_sz);
+        }
+    }
+    hash_map_image_header_t header = {
+        .magic = HASH_MAP_IMAGE_MAGIC,
+        .version = HASH_MAP_IMAGE_VERSION,
+        .capacity = capacity,
+        .size = this->size,
+        .buckets_offset = buckets_offset,
+        .blob_offset = blob_offset,
+        .image_size = image_size
+    };
+    static const unsigned char padding[HASH_MAP_IMAGE_ALIGNMENT];
+    unsigned char written = fwrite(&header, sizeof(header), 1ul, file) == 1ul
+        && fwrite(padding, 1ul, buckets_offset - sizeof(header), file) == buckets_offset - sizeof(header);
+    // buckets
+    size_t offset = blob_offset;
+    for (size_t i = 0ul; written && i < capacity; ++i) {
+        const bucket_t *const b = hash_map_bucket(this, i);
+        hash_map_image_bucket_t image_bucket = {
+            .key_offset = 0ull,
+            .key_sz = 0ull,
+            .data_offset = 0ull,
+            .data_sz = 0ull,
+            .next = 0ull
+        };
+        if (b->key.data != NULL) {
+            image_bucket.key_offset = offset;
+            image_bucket.key_sz = b->key.type_sz;
+            offset = hash_map_image_align(offset + b->key.type_sz);
+            image_bucket.data_offset = offset;
+            image_bucket.data_sz = b->data.type_sz;
+            offset = hash_map_image_align(offset + b->data.type_sz);
+            image_bucket.next = b->next;
+        }
+        written = fwrite(&image_bucket, sizeof(image_bucket), 1ul, file) == 1ul;
+    }
+    if (written) {
+        const size_t buckets_padding = blob_offset - buckets_offset - capacity * sizeof(hash_map_image_bucket_t);
+        written = fwrite(padding, 1ul, buckets_padding, file) == buckets_padding;
+    }
+    // blob
+    offset = blob_offset;
+    for (size_t i = 0ul; written && i < capacity; ++i) {
+        const bucket_t *const b = hash_map_bucket(this, i);
+        if (b->key.data == NULL) {
+            continue;
+        }
+        const node_data_t *const parts[] = {&b->key, &b->data};
+        for (size_t j = 0ul; written && j < sizeof(parts) / sizeof(*parts); ++j) {
+            const size_t next_offset = hash_map_image_align(offset + parts[j]->type_sz);
+            written = fwrite(parts[j]->data, 1ul, parts[j]->type_sz, file) == parts[j]->type_sz
+                && fwrite(padding, 1ul, next_offset - offset - parts[j]->type_sz, file) == next_offset - offset - parts[j]->type_sz;
+            offset = next_offset;
+        }
+    }
+    if (fclose(file) != 0 || !written) {
+        fprintf(stderr, "fwrite failure in hash_map_save for path %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+[[nodiscard]] static unsigned char hash_map_image_span_valid(
+    const hash_map_image_header_t *const header,
+    const unsigned long long offset,
+    const unsigned long long size
+) {
+    return offset >= header->blob_offset && offset <= header->image_size && size <= header->image_size - offset;
+}
+
+[[nodiscard]] static unsigned char hash_map_image_valid(
+    const void *const image,
+    const size_t image_size
+) {
+    // header only, buckets are checked as lookups visit them so opening stays O(1)
+    const hash_map_image_header_t *const header = image;
+    static const char magic[] = HASH_MAP_IMAGE_MAGIC;
+    return memcmp(header->magic, magic, sizeof(header->magic)) == 0
+        && header->version == HASH_MAP_IMAGE_VERSION
+        && header->image_size == (unsigned long long)image_size
+        && HASH_MAP_MOD(header->capacity) != 0ull
+        && header->size <= header->capacity
+        && header->buckets_offset >= sizeof(hash_map_image_header_t)
+        && header->buckets_offset % _Alignof(hash_map_image_bucket_t) == 0ull
+        && header->blob_offset >= header->buckets_offset
+        && header->blob_offset <= header->image_size
+        && header->capacity <= (header->blob_offset - header->buckets_offset) / sizeof(hash_map_image_bucket_t);
+}
+
+[[nodiscard]] static unsigned char hash_map_image_bucket_valid(
+    const hash_map_image_header_t *const restrict header,
+    const hash_map_image_bucket_t *const restrict b
+) {
+    return hash_map_image_span_valid(header, b->key_offset, b->key_sz)
+        && hash_map_image_span_valid(header, b->data_offset, b->data_sz)
+        && b->next <= header->capacity;
+}
+
+[[nodiscard]] hash_map_mmap_t *hash_map_open_mmap(
+    const char *const path,
+    const hash_t hash_function,
+    const comparator_t key_comparator
+) {
+    if (path == NULL || hash_function == NULL || key_comparator == NULL) {
+        return NULL;
+    }
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "open failure in hash_map_open_mmap for path %s\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hash_map_image_header_t)) {
+        fprintf(stderr, "invalid image in hash_map_open_mmap for path %s\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *const image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        fprintf(stderr, "mmap failure in hash_map_open_mmap for path %s\n", path);
+        return NULL;
+    }
+    if (!hash_map_image_valid(image, (size_t)st.st_size)) {
+        fprintf(stderr, "invalid image in hash_map_open_mmap for path %s\n", path);
+        munmap(image, (size_t)st.st_size);
+        return NULL;
+    }
+    const hash_map_image_header_t *const header = image;
+    hash_map_mmap_t *const hm = malloc(sizeof(hash_map_mmap_t));
+    if (hm == NULL) {
+        fprintf(stderr, "malloc NULL return in hash_map_open_mmap\n");
+        munmap(image, (size_t)st.st_size);
+        return NULL;
+    }
+    hm->image = image;
+    hm->image_size = (size_t)st.st_size;
+    hm->buckets = (const hash_map_image_bucket_t*)((const unsigned char*)image + header->buckets_offset);
+    hm->capacity = header->capacity;
+    hm->size = header->size;
+    hm->hash_function = hash_function;
+    hm->key_comparator = key_comparator;
+    return hm;
+}
+
+[[nodiscard]] size_t hash_map_mmap_size(const hash_map_mmap_t *const this) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    return this->size;
+}
+
+[[nodiscard]] node_data_t hash_map_mmap_at(
+    const hash_map_mmap_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    node_data_t data = {
+        .type_sz = 0ul,
+        .data = NULL
+    };
+    if (this == NULL || this->size == 0ul) {
+        return data;
+    }
+    const unsigned char *const image = this->image;
+    const hash_map_image_header_t *const header = this->image;
+    unsigned long long index = this->hash_function(HASH_MAP_MOD(this->capacity), key_sz, key);
+    const hash_map_image_bucket_t *b = this->buckets + index;
+    if (b->key_offset == 0ull) {
+        return data;
+    }
+    // a chain visits every bucket at most once, longer walks mean a cyclic image
+    for (size_t steps = 0ul; steps < this->capacity; ++steps) {
+        if (!hash_map_image_bucket_valid(header, b)) { // corrupt bucket, also a link to an empty one
+            return data;
+        }
+        if (this->key_comparator(key, image + b->key_offset) == 0) { // key == b->key
+            data.type_sz = b->data_sz;
+            data.data = (void*)(image + b->data_offset); // read only mapping
+            return data;
+        }
+        if (b->next == 0ull) {
+            return data;
+        }
+        b = this->buckets + b->next - 1ull;
+    }
+    return data;
+}
+
+void hash_map_mmap_close(hash_map_mmap_t *const this) {
+    if (this == NULL) {
+        return;
+    }
+    munmap(this->image, this->image_size);
+    free(this);
+}
+
 // hash functions
 
 [[nodiscard]] static unsigned long long pow_mod(
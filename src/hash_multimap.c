@@ -0,0 +1,503 @@
+#include "hash_multimap.h"
+#include "hash_map_chain.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define HASH_MULTIMAP_STACK_CAPACITY 1ul
+#define HASH_MULTIMAP_MIN_CAPACITY (2ul)
+#define VALUE_GROUP_MIN_CAPACITY 2ul
+#define VALUE_GROUP_ALIGNMENT _Alignof(max_align_t) // every stored value starts aligned like a malloc result
+
+typedef struct value_group value_group_t;
+
+struct value_group {
+    size_t count;
+    size_t capacity;
+    unsigned char *storage; // non intrusive value bytes, each starting at a VALUE_GROUP_ALIGNMENT offset
+    size_t storage_size;
+    size_t storage_capacity;
+    node_data_t values[];
+};
+
+struct group_bucket {
+    node_data_t key;
+    value_group_t *group;
+    size_t next; // bucket index + 1, 0 for chain end (coalesced hashing)
+};
+
+struct hash_multimap {
+    group_bucket_t stack_buffer[HASH_MULTIMAP_STACK_CAPACITY]; // Small Object Optimization
+    group_bucket_t *heap_buffer;
+    size_t heap_buffer_capacity;
+    size_t keys_size;
+    size_t size;
+    size_t free_cursor; // free bucket lookup position, moves towards the beginning
+    hash_t hash_function;
+    comparator_t key_comparator;
+};
+
+[[nodiscard]] hash_multimap_t *hash_multimap_init(
+    size_t capacity,
+    const hash_t hash_function,
+    const comparator_t key_comparator
+) {
+    if (hash_function == NULL || key_comparator == NULL) {
+        return NULL;
+    }
+    hash_multimap_t *const hm = malloc(sizeof(hash_multimap_t));
+    if (hm == NULL) {
+        fprintf(stderr, "malloc NULL return in hash_multimap_init\n");
+        return hm;
+    }
+    hm->hash_function = hash_function;
+    hm->key_comparator = key_comparator;
+    hm->keys_size = 0ul;
+    hm->size = 0ul;
+    for (size_t i = 0ul; i < HASH_MULTIMAP_STACK_CAPACITY; ++i) {
+        group_bucket_t *const b = hm->stack_buffer + i;
+        b->key.data = NULL;
+        b->key.type_sz = 0ul;
+        b->group = NULL;
+        b->next = 0ul;
+    }
+    group_bucket_t *heap_buffer = NULL;
+    size_t heap_buffer_capacity = 0ul;
+    if (capacity < HASH_MULTIMAP_MIN_CAPACITY) {
+        capacity = HASH_MULTIMAP_MIN_CAPACITY;
+    }
+    if (capacity > HASH_MULTIMAP_STACK_CAPACITY) {
+        heap_buffer_capacity = capacity - HASH_MULTIMAP_STACK_CAPACITY;
+        heap_buffer = calloc(heap_buffer_capacity, sizeof(group_bucket_t));
+        if (heap_buffer == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_multimap_init for capacity %lu\n", capacity);
+            heap_buffer_capacity = 0ul;
+        }
+    }
+    hm->heap_buffer = heap_buffer;
+    hm->heap_buffer_capacity = heap_buffer_capacity;
+    hm->free_cursor = HASH_MULTIMAP_STACK_CAPACITY + heap_buffer_capacity;
+    return hm;
+}
+
+[[nodiscard]] size_t hash_multimap_size(const hash_multimap_t *const this) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    return this->size;
+}
+
+[[nodiscard]] static group_bucket_t *hash_multimap_bucket(
+    const hash_multimap_t *const this,
+    const size_t index
+) {
+    assert(index < HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity);
+    if (index < HASH_MULTIMAP_STACK_CAPACITY) {
+        return (group_bucket_t*)this->stack_buffer + index;
+    }
+    return this->heap_buffer + index - HASH_MULTIMAP_STACK_CAPACITY;
+}
+
+[[nodiscard]] static size_t hash_multimap_capacity(const hash_multimap_t *const this) {
+    return HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity;
+}
+
+[[nodiscard]] static unsigned char hash_multimap_occupied(const group_bucket_t *const b) {
+    return b->key.data != NULL;
+}
+
+[[nodiscard]] static size_t hash_multimap_home(
+    const hash_multimap_t *const restrict this,
+    const group_bucket_t *const restrict b
+) {
+    return this->hash_function(HASH_MAP_MOD(hash_multimap_capacity(this)), b->key.type_sz, b->key.data);
+}
+
+static void hash_multimap_clear(group_bucket_t *const b) {
+    b->key.data = NULL;
+    b->key.type_sz = 0ul;
+    b->group = NULL;
+}
+
+HASH_MAP_CHAIN_DEFINE(hash_multimap, hash_multimap_t, group_bucket_t)
+
+static void hash_multimap_place(
+    hash_multimap_t *const this,
+    const node_data_t key,
+    value_group_t *const group
+) {
+    // key is known to be absent, no lookup or copy
+    const size_t capacity = hash_multimap_capacity(this);
+    group_bucket_t *const b = hash_multimap_link(this, this->hash_function(HASH_MAP_MOD(capacity), key.type_sz, key.data));
+    assert(b != NULL);
+    b->key = key;
+    b->group = group;
+    ++this->keys_size;
+}
+
+static void hash_multimap_rehash(
+    hash_multimap_t *const this,
+    const size_t capacity
+) {
+    assert(this != NULL && capacity != 0ul);
+    hash_multimap_t rehashed = *this;
+    rehashed.keys_size = 0ul;
+    rehashed.free_cursor = capacity;
+    rehashed.heap_buffer = NULL;
+    rehashed.heap_buffer_capacity = 0ul;
+    for (size_t i = 0ul; i < HASH_MULTIMAP_STACK_CAPACITY; ++i) {
+        group_bucket_t *const b = rehashed.stack_buffer + i;
+        b->key.data = NULL;
+        b->key.type_sz = 0ul;
+        b->group = NULL;
+        b->next = 0ul;
+    }
+    if (capacity > HASH_MULTIMAP_STACK_CAPACITY) {
+        const size_t heap_buffer_capacity = capacity - HASH_MULTIMAP_STACK_CAPACITY;
+        group_bucket_t *const heap_buffer = calloc(heap_buffer_capacity, sizeof(group_bucket_t));
+        if (heap_buffer == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_multimap_rehash for capacity %lu\n", capacity);
+            return;
+        }
+        rehashed.heap_buffer = heap_buffer;
+        rehashed.heap_buffer_capacity = heap_buffer_capacity;
+    }
+    const size_t old_capacity = HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    for (size_t i = 0ul; i < old_capacity; ++i) {
+        const group_bucket_t *const b = hash_multimap_bucket(this, i);
+        if (b->key.data != NULL) {
+            hash_multimap_place(&rehashed, b->key, b->group);
+        }
+    }
+    free(this->heap_buffer);
+    *this = rehashed;
+}
+
+[[nodiscard]] static group_bucket_t *hash_multimap_bucket_at(
+    const hash_multimap_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    const size_t capacity = HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    assert(this != NULL && capacity != 0ul);
+    if (this->keys_size == 0ul) {
+        return NULL;
+    }
+    group_bucket_t *b = hash_multimap_bucket(this, this->hash_function(HASH_MAP_MOD(capacity), key_sz, key));
+    if (b->key.data == NULL) {
+        return NULL;
+    }
+    for (;;) {
+        if (this->key_comparator(key, b->key.data) == 0) { // key == b->key
+            return b;
+        }
+        if (b->next == 0ul) {
+            return NULL;
+        }
+        b = hash_multimap_bucket(this, b->next - 1ul);
+    }
+}
+
+[[nodiscard]] static size_t value_group_align(const size_t offset) {
+    return (offset + VALUE_GROUP_ALIGNMENT - 1ul) / VALUE_GROUP_ALIGNMENT * VALUE_GROUP_ALIGNMENT;
+}
+
+[[nodiscard]] static unsigned char value_group_reserve(
+    value_group_t **const group_ptr,
+    const size_t data_sz,
+    const unsigned char intrusive
+) {
+    value_group_t *group = *group_ptr;
+    if (group == NULL || group->count == group->capacity) {
+        const size_t capacity = group == NULL ? VALUE_GROUP_MIN_CAPACITY : group->capacity << 1;
+        value_group_t *const new_group = realloc(group, sizeof(value_group_t) + capacity * sizeof(node_data_t));
+        if (new_group == NULL) {
+            fprintf(stderr, "realloc NULL return in value_group_reserve for capacity %lu\n", capacity);
+            return 0;
+        }
+        if (group == NULL) {
+            new_group->count = 0ul;
+            new_group->storage = NULL;
+            new_group->storage_size = 0ul;
+            new_group->storage_capacity = 0ul;
+        }
+        new_group->capacity = capacity;
+        group = new_group;
+        *group_ptr = group;
+    }
+    const size_t required_storage = value_group_align(group->storage_size) + data_sz;
+    if (!intrusive && (group->storage == NULL || required_storage > group->storage_capacity)) {
+        const size_t storage_capacity = (required_storage + VALUE_GROUP_ALIGNMENT) << 1;
+        const uintptr_t old_storage = (uintptr_t)group->storage;
+        unsigned char *const storage = realloc(group->storage, storage_capacity);
+        if (storage == NULL) {
+            fprintf(stderr, "realloc NULL return in value_group_reserve for storage capacity %lu\n", storage_capacity);
+            return 0;
+        }
+        // values keep pointing to the moved storage
+        for (size_t i = 0ul; i < group->count; ++i) {
+            const uintptr_t data = (uintptr_t)group->values[i].data;
+            if (old_storage != 0u && data >= old_storage && data <= old_storage + group->storage_size) {
+                group->values[i].data = storage + (data - old_storage);
+            }
+        }
+        group->storage = storage;
+        group->storage_capacity = storage_capacity;
+    }
+    return 1;
+}
+
+void hash_multimap_insert(
+    hash_multimap_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key,
+    const size_t data_sz,
+    const void *const restrict data,
+    const unsigned char intrusive
+) {
+    if (this == NULL) {
+        return;
+    }
+    group_bucket_t *const b = hash_multimap_bucket_at(this, key_sz, key);
+    if (b == NULL) { // new key, rehash before its group exists
+        const size_t capacity = HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity;
+        const long double load_factor = (long double)(this->keys_size + 1ul) / (long double)capacity;
+        if (load_factor > HASH_MAP_LOAD_FACTOR_MAX) {
+            hash_multimap_rehash(this, (capacity + 1ul) << 1);
+            if (this->keys_size + 1ul > HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity) {
+                return;
+            }
+        }
+    }
+    value_group_t *group = b != NULL ? b->group : NULL;
+    const unsigned char reserved = value_group_reserve(&group, data_sz, intrusive);
+    if (b != NULL) {
+        b->group = group;
+    }
+    if (!reserved) {
+        if (b == NULL && group != NULL) {
+            free(group->storage);
+            free(group);
+        }
+        return;
+    }
+    node_data_t *const value = group->values + group->count;
+    value->type_sz = data_sz;
+    if (intrusive) {
+        value->data = (void*)data;
+    } else {
+        const size_t offset = value_group_align(group->storage_size);
+        value->data = group->storage + offset;
+        memcpy(value->data, data, data_sz);
+        group->storage_size = offset + data_sz;
+    }
+    ++group->count;
+    ++this->size;
+    if (b != NULL) { // appended to present key group
+        return;
+    }
+    // insertion
+    node_data_t new_key = {
+        .type_sz = key_sz,
+        .data = (void*)key
+    };
+    if (!intrusive) {
+        new_key.data = malloc(key_sz);
+        if (new_key.data == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_multimap_insert for key_sz %lu\n", key_sz);
+            free(group->storage);
+            free(group);
+            --this->size;
+            return;
+        }
+        memcpy(new_key.data, key, key_sz);
+    }
+    hash_multimap_place(this, new_key, group);
+}
+
+void hash_multimap_remove(
+    hash_multimap_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key,
+    const unsigned char intrusive
+) {
+    if (this == NULL || this->keys_size == 0ul) {
+        return;
+    }
+    size_t capacity = HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    group_bucket_t *b = hash_multimap_bucket(this, this->hash_function(HASH_MAP_MOD(capacity), key_sz, key));
+    if (b->key.data == NULL) { // not present -> exit
+        return;
+    }
+    // lookup
+    group_bucket_t *prev_bucket = NULL;
+    while (this->key_comparator(key, b->key.data) != 0) {
+        if (b->next == 0ul) { // not present -> exit
+            return;
+        }
+        prev_bucket = b;
+        b = hash_multimap_bucket(this, b->next - 1ul);
+    }
+    // present -> removing
+    const group_bucket_t removed = *b;
+    if (!hash_multimap_unlink(this, prev_bucket, b)) {
+        return;
+    }
+    if (!intrusive) {
+        free(removed.key.data);
+    }
+    this->size -= removed.group->count;
+    free(removed.group->storage);
+    free(removed.group);
+    --this->keys_size;
+    // rehash
+    const long double load_factor = (long double)this->keys_size / (long double)capacity;
+    if (load_factor < HASH_MAP_LOAD_FACTOR_MIN && capacity > HASH_MULTIMAP_MIN_CAPACITY) {
+        capacity >>= 1;
+        if (capacity < HASH_MULTIMAP_MIN_CAPACITY) {
+            capacity = HASH_MULTIMAP_MIN_CAPACITY;
+        }
+        hash_multimap_rehash(this, capacity);
+    }
+}
+
+static void value_group_compact(
+    value_group_t *const group,
+    const size_t index
+) {
+    // stored bytes after the removed value move down over its slot
+    const uintptr_t storage = (uintptr_t)group->storage;
+    const uintptr_t data = (uintptr_t)group->values[index].data;
+    const size_t storage_size = group->storage_size;
+    if (storage == 0u || data < storage || data >= storage + storage_size) { // intrusive or empty value
+        return;
+    }
+    const size_t offset = data - storage;
+    const size_t slot_end = value_group_align(offset + group->values[index].type_sz);
+    if (slot_end >= storage_size) {
+        group->storage_size = offset;
+        return;
+    }
+    const size_t slot_size = slot_end - offset;
+    memmove(group->storage + offset, group->storage + slot_end, storage_size - slot_end);
+    group->storage_size = storage_size - slot_size;
+    for (size_t i = 0ul; i < group->count; ++i) {
+        const uintptr_t value_data = (uintptr_t)group->values[i].data;
+        if (value_data >= storage + slot_end && value_data <= storage + storage_size) {
+            group->values[i].data = group->storage + (value_data - storage - slot_size);
+        }
+    }
+}
+
+void hash_multimap_remove_at(
+    hash_multimap_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key,
+    const size_t index,
+    const unsigned char intrusive
+) {
+    if (this == NULL) {
+        return;
+    }
+    group_bucket_t *const b = hash_multimap_bucket_at(this, key_sz, key);
+    if (b == NULL || index >= b->group->count) {
+        return;
+    }
+    if (b->group->count == 1ul) {
+        hash_multimap_remove(this, key_sz, key, intrusive);
+        return;
+    }
+    value_group_t *const group = b->group;
+    value_group_compact(group, index);
+    // order is not preserved, the last value takes the gap
+    group->values[index] = group->values[--group->count];
+    --this->size;
+}
+
+[[nodiscard]] size_t hash_multimap_count(
+    const hash_multimap_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    const group_bucket_t *const b = hash_multimap_bucket_at(this, key_sz, key);
+    return b != NULL ? b->group->count : 0ul;
+}
+
+[[nodiscard]] node_data_t *hash_multimap_equal_range(
+    const hash_multimap_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key,
+    size_t *const restrict count
+) {
+    if (count != NULL) {
+        *count = 0ul;
+    }
+    if (this == NULL) {
+        return NULL;
+    }
+    const group_bucket_t *const b = hash_multimap_bucket_at(this, key_sz, key);
+    if (b == NULL) {
+        return NULL;
+    }
+    if (count != NULL) {
+        *count = b->group->count;
+    }
+    return b->group->values;
+}
+
+void hash_multimap_delete(
+    hash_multimap_t *const this,
+    const unsigned char intrusive
+) {
+    if (this == NULL) {
+        return;
+    }
+    const size_t capacity = HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    for (size_t i = 0ul; i < capacity; ++i) {
+        const group_bucket_t *const b = hash_multimap_bucket(this, i);
+        if (b->key.data != NULL) {
+            if (!intrusive) {
+                free(b->key.data);
+            }
+            free(b->group->storage);
+            free(b->group);
+        }
+    }
+    free(this->heap_buffer);
+    free(this);
+}
+
+void hash_multimap_print(
+    const hash_multimap_t *const this,
+    const print_t print_key,
+    const print_t print_data
+) {
+    printf("{");
+    unsigned char not_first = 0;
+    const size_t capacity = HASH_MULTIMAP_STACK_CAPACITY + this->heap_buffer_capacity;
+    for (size_t i = 0ul; i < capacity; ++i) {
+        const group_bucket_t *const b = hash_multimap_bucket(this, i);
+        if (b->key.data != NULL) {
+            if (not_first) {
+                printf(", ");
+            } else {
+                not_first = 1;
+            }
+            print_key(b->key.data);
+            printf(": [");
+            for (size_t j = 0ul; j < b->group->count; ++j) {
+                if (j > 0ul) {
+                    printf(", ");
+                }
+                print_data(b->group->values[j].data);
+            }
+            printf("]");
+        }
+    }
+    printf("}\n");
+}
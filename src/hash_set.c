@@ -0,0 +1,364 @@
+#include "hash_set.h"
+#include "hash_map_chain.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define HASH_SET_STACK_CAPACITY 1ul
+#define HASH_SET_MIN_CAPACITY (2ul)
+
+struct key_bucket {
+    node_data_t key;
+    size_t next; // bucket index + 1, 0 for chain end (coalesced hashing)
+};
+
+struct hash_set {
+    key_bucket_t stack_buffer[HASH_SET_STACK_CAPACITY]; // Small Object Optimization
+    key_bucket_t *heap_buffer;
+    size_t heap_buffer_capacity;
+    size_t size;
+    size_t free_cursor; // free bucket lookup position, moves towards the beginning
+    hash_t hash_function;
+    comparator_t key_comparator;
+};
+
+[[nodiscard]] hash_set_t *hash_set_init(
+    size_t capacity,
+    const hash_t hash_function,
+    const comparator_t key_comparator
+) {
+    if (hash_function == NULL || key_comparator == NULL) {
+        return NULL;
+    }
+    hash_set_t *const hs = malloc(sizeof(hash_set_t));
+    if (hs == NULL) {
+        fprintf(stderr, "malloc NULL return in hash_set_init\n");
+        return hs;
+    }
+    hs->hash_function = hash_function;
+    hs->key_comparator = key_comparator;
+    hs->size = 0ul;
+    for (size_t i = 0ul; i < HASH_SET_STACK_CAPACITY; ++i) {
+        key_bucket_t *const b = hs->stack_buffer + i;
+        b->key.data = NULL;
+        b->key.type_sz = 0ul;
+        b->next = 0ul;
+    }
+    key_bucket_t *heap_buffer = NULL;
+    size_t heap_buffer_capacity = 0ul;
+    if (capacity < HASH_SET_MIN_CAPACITY) {
+        capacity = HASH_SET_MIN_CAPACITY;
+    }
+    if (capacity > HASH_SET_STACK_CAPACITY) {
+        heap_buffer_capacity = capacity - HASH_SET_STACK_CAPACITY;
+        heap_buffer = calloc(heap_buffer_capacity, sizeof(key_bucket_t));
+        if (heap_buffer == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_set_init for capacity %lu\n", capacity);
+            heap_buffer_capacity = 0ul;
+        }
+    }
+    hs->heap_buffer = heap_buffer;
+    hs->heap_buffer_capacity = heap_buffer_capacity;
+    hs->free_cursor = HASH_SET_STACK_CAPACITY + heap_buffer_capacity;
+    return hs;
+}
+
+[[nodiscard]] size_t hash_set_size(const hash_set_t *const this) {
+    if (this == NULL) {
+        return 0ul;
+    }
+    return this->size;
+}
+
+[[nodiscard]] static key_bucket_t *hash_set_bucket(
+    const hash_set_t *const this,
+    const size_t index
+) {
+    assert(index < HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity);
+    if (index < HASH_SET_STACK_CAPACITY) {
+        return (key_bucket_t*)this->stack_buffer + index;
+    }
+    return this->heap_buffer + index - HASH_SET_STACK_CAPACITY;
+}
+
+[[nodiscard]] static size_t hash_set_capacity(const hash_set_t *const this) {
+    return HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity;
+}
+
+[[nodiscard]] static unsigned char hash_set_occupied(const key_bucket_t *const b) {
+    return b->key.data != NULL;
+}
+
+[[nodiscard]] static size_t hash_set_home(
+    const hash_set_t *const restrict this,
+    const key_bucket_t *const restrict b
+) {
+    return this->hash_function(HASH_MAP_MOD(hash_set_capacity(this)), b->key.type_sz, b->key.data);
+}
+
+static void hash_set_clear(key_bucket_t *const b) {
+    b->key.data = NULL;
+    b->key.type_sz = 0ul;
+}
+
+HASH_MAP_CHAIN_DEFINE(hash_set, hash_set_t, key_bucket_t)
+
+static void hash_set_place(
+    hash_set_t *const this,
+    const node_data_t key
+) {
+    // key is known to be absent, no lookup or copy
+    const size_t capacity = hash_set_capacity(this);
+    key_bucket_t *const b = hash_set_link(this, this->hash_function(HASH_MAP_MOD(capacity), key.type_sz, key.data));
+    assert(b != NULL);
+    b->key = key;
+    ++this->size;
+}
+
+static void hash_set_rebuild(
+    hash_set_t *const restrict this,
+    const size_t capacity,
+    const hash_set_t *const restrict other,
+    const unsigned char keep_present,
+    const unsigned char intrusive
+) {
+    // rehash, keeping every key when other is NULL, or keys whose presence in other equals keep_present
+    assert(this != NULL && capacity != 0ul);
+    hash_set_t rebuilt = *this;
+    rebuilt.size = 0ul;
+    rebuilt.free_cursor = capacity;
+    rebuilt.heap_buffer = NULL;
+    rebuilt.heap_buffer_capacity = 0ul;
+    for (size_t i = 0ul; i < HASH_SET_STACK_CAPACITY; ++i) {
+        key_bucket_t *const b = rebuilt.stack_buffer + i;
+        b->key.data = NULL;
+        b->key.type_sz = 0ul;
+        b->next = 0ul;
+    }
+    if (capacity > HASH_SET_STACK_CAPACITY) {
+        const size_t heap_buffer_capacity = capacity - HASH_SET_STACK_CAPACITY;
+        key_bucket_t *const heap_buffer = calloc(heap_buffer_capacity, sizeof(key_bucket_t));
+        if (heap_buffer == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_set_rebuild for capacity %lu\n", capacity);
+            return;
+        }
+        rebuilt.heap_buffer = heap_buffer;
+        rebuilt.heap_buffer_capacity = heap_buffer_capacity;
+    }
+    const size_t old_capacity = HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity;
+    for (size_t i = 0ul; i < old_capacity; ++i) {
+        const key_bucket_t *const b = hash_set_bucket(this, i);
+        if (b->key.data == NULL) {
+            continue;
+        }
+        if (other == NULL || hash_set_contains(other, b->key.type_sz, b->key.data) == keep_present) {
+            hash_set_place(&rebuilt, b->key);
+        } else if (!intrusive) {
+            free(b->key.data);
+        }
+    }
+    free(this->heap_buffer);
+    *this = rebuilt;
+}
+
+[[nodiscard]] static key_bucket_t *hash_set_bucket_at(
+    const hash_set_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    const size_t capacity = HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity;
+    assert(this != NULL && capacity != 0ul);
+    key_bucket_t *b = hash_set_bucket(this, this->hash_function(HASH_MAP_MOD(capacity), key_sz, key));
+    if (b->key.data == NULL) {
+        return NULL;
+    }
+    for (;;) {
+        if (this->key_comparator(key, b->key.data) == 0) { // key == b->key
+            return b;
+        }
+        if (b->next == 0ul) {
+            return NULL;
+        }
+        b = hash_set_bucket(this, b->next - 1ul);
+    }
+}
+
+[[nodiscard]] unsigned char hash_set_contains(
+    const hash_set_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key
+) {
+    if (this == NULL || this->size == 0ul) {
+        return 0;
+    }
+    return hash_set_bucket_at(this, key_sz, key) != NULL;
+}
+
+void hash_set_insert(
+    hash_set_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key,
+    const unsigned char intrusive
+) {
+    if (this == NULL || hash_set_contains(this, key_sz, key)) {
+        return;
+    }
+    // rehash
+    const size_t capacity = HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity;
+    const long double load_factor = (long double)(this->size + 1ul) / (long double)capacity;
+    if (load_factor > HASH_MAP_LOAD_FACTOR_MAX) {
+        hash_set_rebuild(this, (capacity + 1ul) << 1, NULL, 0, intrusive);
+        if (this->size + 1ul > HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity) {
+            return;
+        }
+    }
+    // insertion
+    node_data_t new_key = {
+        .type_sz = key_sz,
+        .data = (void*)key
+    };
+    if (!intrusive) {
+        new_key.data = malloc(key_sz);
+        if (new_key.data == NULL) {
+            fprintf(stderr, "malloc NULL return in hash_set_insert for key_sz %lu\n", key_sz);
+            return;
+        }
+        memcpy(new_key.data, key, key_sz);
+    }
+    hash_set_place(this, new_key);
+}
+
+void hash_set_remove(
+    hash_set_t *const restrict this,
+    const size_t key_sz,
+    const void *const restrict key,
+    const unsigned char intrusive
+) {
+    if (this == NULL || this->size == 0ul) {
+        return;
+    }
+    size_t capacity = HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity;
+    key_bucket_t *b = hash_set_bucket(this, this->hash_function(HASH_MAP_MOD(capacity), key_sz, key));
+    if (b->key.data == NULL) { // not present -> exit
+        return;
+    }
+    // lookup
+    key_bucket_t *prev_bucket = NULL;
+    while (this->key_comparator(key, b->key.data) != 0) {
+        if (b->next == 0ul) { // not present -> exit
+            return;
+        }
+        prev_bucket = b;
+        b = hash_set_bucket(this, b->next - 1ul);
+    }
+    // present -> removing
+    void *const removed = b->key.data;
+    if (!hash_set_unlink(this, prev_bucket, b)) {
+        return;
+    }
+    if (!intrusive) {
+        free(removed);
+    }
+    --this->size;
+    // rehash
+    const long double load_factor = (long double)this->size / (long double)capacity;
+    if (load_factor < HASH_MAP_LOAD_FACTOR_MIN && capacity > HASH_SET_MIN_CAPACITY) {
+        capacity >>= 1;
+        if (capacity < HASH_SET_MIN_CAPACITY) {
+            capacity = HASH_SET_MIN_CAPACITY;
+        }
+        hash_set_rebuild(this, capacity, NULL, 0, intrusive);
+    }
+}
+
+[[nodiscard]] node_data_t *hash_set_iterate(
+    const hash_set_t *const restrict this,
+    size_t *const restrict cursor
+) {
+    if (this == NULL || cursor == NULL) {
+        return NULL;
+    }
+    const size_t capacity = HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity;
+    while (*cursor < capacity) {
+        key_bucket_t *const b = hash_set_bucket(this, (*cursor)++);
+        if (b->key.data != NULL) {
+            return &b->key;
+        }
+    }
+    return NULL;
+}
+
+void hash_set_union(
+    hash_set_t *const restrict this,
+    const hash_set_t *const restrict other,
+    const unsigned char intrusive
+) {
+    if (this == NULL || other == NULL) {
+        return;
+    }
+    // growing once in advance
+    const size_t required_capacity = (size_t)((long double)(this->size + other->size) / HASH_MAP_LOAD_FACTOR_MAX) + 1ul;
+    if (required_capacity > HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity) {
+        hash_set_rebuild(this, required_capacity, NULL, 0, intrusive);
+    }
+    size_t cursor = 0ul;
+    for (const node_data_t *key = hash_set_iterate(other, &cursor); key != NULL; key = hash_set_iterate(other, &cursor)) {
+        hash_set_insert(this, key->type_sz, key->data, intrusive);
+    }
+}
+
+void hash_set_intersection(
+    hash_set_t *const restrict this,
+    const hash_set_t *const restrict other,
+    const unsigned char intrusive
+) {
+    if (this == NULL || other == NULL) {
+        return;
+    }
+    hash_set_rebuild(this, HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity, other, 1, intrusive);
+}
+
+void hash_set_difference(
+    hash_set_t *const restrict this,
+    const hash_set_t *const restrict other,
+    const unsigned char intrusive
+) {
+    if (this == NULL || other == NULL) {
+        return;
+    }
+    hash_set_rebuild(this, HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity, other, 0, intrusive);
+}
+
+void hash_set_delete(
+    hash_set_t *const this,
+    const unsigned char intrusive
+) {
+    if (this == NULL) {
+        return;
+    }
+    if (!intrusive) {
+        const size_t capacity = HASH_SET_STACK_CAPACITY + this->heap_buffer_capacity;
+        for (size_t i = 0ul; i < capacity; ++i) {
+            free(hash_set_bucket(this, i)->key.data);
+        }
+    }
+    free(this->heap_buffer);
+    free(this);
+}
+
+void hash_set_print(
+    const hash_set_t *const this,
+    const print_t print_key
+) {
+    printf("{");
+    size_t cursor = 0ul;
+    const node_data_t *key = hash_set_iterate(this, &cursor);
+    while (key != NULL) {
+        print_key(key->data);
+        key = hash_set_iterate(this, &cursor);
+        if (key != NULL) {
+            printf(", ");
+        }
+    }
+    printf("}\n");
+}
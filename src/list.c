@@ -67,6 +67,7 @@ static list_node_t *list_node_init(
         new_data = malloc(type_sz);
         if (new_data == NULL) {
             fprintf(stderr, "malloc NULL return in list_node_init for type_sz %lu\n", type_sz);
+            free(new_node);
             return NULL;
         }
         memcpy(new_data, data, type_sz);
@@ -100,17 +101,26 @@ void list_insert(
     }
     if (this->head == NULL) {
         list_node_t *new_node = list_node_init(type_sz, data, NULL, NULL, intrusive);
+        if (new_node == NULL) {
+            return;
+        }
         this->head = new_node;
         this->tail = new_node;
         return;
     }
     if (index == 0) {
         list_node_t *new_node = list_node_init(type_sz, data, NULL, this->head, intrusive);
+        if (new_node == NULL) {
+            return;
+        }
         this->head = new_node;
         return;
     }
     if (index == size) {
         list_node_t *new_node = list_node_init(type_sz, data, this->tail, NULL, intrusive);
+        if (new_node == NULL) {
+            return;
+        }
         this->tail = new_node;
         return;
     }
@@ -144,11 +154,17 @@ void list_push_back(
     }
     if (this->head == NULL) {
         list_node_t *new_node = list_node_init(type_sz, data, NULL, NULL, intrusive);
+        if (new_node == NULL) {
+            return;
+        }
         this->head = new_node;
         this->tail = new_node;
         return;
     }
     list_node_t *new_node = list_node_init(type_sz, data, this->tail, NULL, intrusive);
+    if (new_node == NULL) {
+        return;
+    }
     this->tail = new_node;
 }
 
@@ -163,11 +179,17 @@ void list_push_front(
     }
     if (this->head == NULL) {
         list_node_t *new_node = list_node_init(type_sz, data, NULL, NULL, intrusive);
+        if (new_node == NULL) {
+            return;
+        }
         this->head = new_node;
         this->tail = new_node;
         return;
     }
     list_node_t *new_node = list_node_init(type_sz, data, NULL, this->head, intrusive);
+    if (new_node == NULL) {
+        return;
+    }
     this->head = new_node;
 }
 
@@ -381,6 +403,58 @@ void list_node_move_to_tail(list_t *const this, list_node_t *const node) {
     this->tail = node;
 }
 
+void list_node_remove(
+    list_t *const this,
+    list_node_t *const node,
+    const unsigned char intrusive
+) {
+    if (this == NULL || node == NULL) {
+        return;
+    }
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        this->head = node->next;
+    }
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    } else {
+        this->tail = node->prev;
+    }
+    if (!intrusive) {
+        free(node->data.data);
+    }
+    free(node);
+}
+
+void list_node_transfer(
+    list_t *restrict const this,
+    list_node_t *const node,
+    list_t *restrict const other
+) {
+    if (this == NULL || node == NULL || other == NULL) {
+        return;
+    }
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        this->head = node->next;
+    }
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    } else {
+        this->tail = node->prev;
+    }
+    node->prev = NULL;
+    node->next = other->head;
+    if (other->head != NULL) {
+        other->head->prev = node;
+    } else {
+        other->tail = node;
+    }
+    other->head = node;
+}
+
 void list_swap(list_t *const this, list_node_t *const i, list_node_t *const j) {
     if (this == NULL || i == NULL || j == NULL || i == j) {
         return;
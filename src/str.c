@@ -1,57 +1,393 @@
 #include "str.h"
 #include <assert.h>
-#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef STRING_ATOMIC_REF_COUNTER
+#include <stdatomic.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
-#define RK_M 256
-#define RK_SHIFT (sizeof(size_t) * CHAR_BIT - 8) // mod (2^{8} = 256)
+#define STRING_NPOS ((size_t)-1)
+#define STRING_SMALL_SIZE_MAX (STRING_SSO_CAPACITY - 1) // the last inline byte holds the terminating NUL
+#define STRING_REPLACE_STACK_MATCHES 64ul
+#define STRING_BUILDER_CHUNK_MIN 256ul
+#define STRING_BUILDER_CHUNK_MAX (1ul << 20)
+#define STRING_ARENA_CHUNK_MIN 4096ul
+#define STRING_ARENA_CHUNK_MAX (1ul << 20)
+// needle length from which Horspool skipping beats the byte filter, whose candidates each cost a needle compare
+#ifdef __SSE2__
+#define STRING_SEARCH_HORSPOOL_MIN 64ul
+#else
+#define STRING_SEARCH_HORSPOOL_MIN 32ul
+#endif
+
+static_assert(STRING_SSO_CAPACITY >= sizeof(string_control_block_t *) + sizeof(size_t), "STRING_SSO_CAPACITY is smaller than the heap string state");
 
 struct string_control_block {
-    char *buffer;
     size_t capacity;
+    size_t size; // characters of the string spanning the whole block, slices never match it
+#ifdef STRING_ATOMIC_REF_COUNTER
+    atomic_size_t ref_counter;
+    atomic_size_t hash; // 0 until computed, owners of equal content race to store the same value
+#else
     size_t ref_counter;
+    size_t hash; // 0 until computed
+#endif
+    char *data; // buffer, or a read only file mapping
+    size_t mapped; // mapping length, 0 for the buffer
+    string_arena_t *arena; // allocating arena, NULL for malloc
+    char buffer[]; // shares the control block allocation
+};
+
+struct string_arena_chunk {
+    string_arena_chunk_t *next;
+    size_t used;
+    size_t capacity;
+    char buffer[];
 };
 
-[[nodiscard]] static string_control_block_t *string_control_block_init(const size_t capacity) {
+struct string_arena {
+    string_arena_chunk_t *head; // bump allocated, the rest are full or dedicated to large blocks
+    size_t chunk_capacity; // next chunk capacity, doubles up to 1 MiB
+    size_t size;
+};
+
+// owners count, acquire pairs with the release in string_control_block_release
+// so writes after observing unique ownership never race with other owners reads
+[[nodiscard]] static inline size_t string_control_block_owners(const string_control_block_t *const control_block) {
+#ifdef STRING_ATOMIC_REF_COUNTER
+    return atomic_load_explicit(&control_block->ref_counter, memory_order_acquire);
+#else
+    return control_block->ref_counter;
+#endif
+}
+
+static inline void string_control_block_share(string_control_block_t *const control_block) {
+#ifdef STRING_ATOMIC_REF_COUNTER
+    atomic_fetch_add_explicit(&control_block->ref_counter, 1, memory_order_relaxed);
+#else
+    ++control_block->ref_counter;
+#endif
+}
+
+// edits in place need the only owner of a buffer, mappings are copied first like shared blocks
+[[nodiscard]] static inline unsigned char string_control_block_writable(const string_control_block_t *const control_block) {
+    return !control_block->mapped && string_control_block_owners(control_block) == 1;
+}
+
+// arena blocks are left to string_arena_reset
+static void string_control_block_free(string_control_block_t *const control_block) {
+    if (control_block->arena) {
+        return;
+    }
+    if (control_block->mapped) {
+        munmap(control_block->data, control_block->mapped);
+    }
+    free(control_block);
+}
+
+// drops one owner, the last one frees the control block
+static inline void string_control_block_release(string_control_block_t *const control_block) {
+#ifdef STRING_ATOMIC_REF_COUNTER
+    if (atomic_fetch_sub_explicit(&control_block->ref_counter, 1, memory_order_release) == 1) {
+        atomic_thread_fence(memory_order_acquire);
+        string_control_block_free(control_block);
+    }
+#else
+    if (!--control_block->ref_counter) {
+        string_control_block_free(control_block);
+    }
+#endif
+}
+
+[[nodiscard]] static void *string_arena_allocate(string_arena_t *const this, size_t size) {
+    size = (size + _Alignof(string_control_block_t) - 1) & ~(_Alignof(string_control_block_t) - 1);
+    string_arena_chunk_t *chunk = this->head;
+    if (!chunk || chunk->capacity - chunk->used < size) {
+        const unsigned char dedicated = size > this->chunk_capacity; // behind the head, keeping its free space
+        const size_t capacity = dedicated ? size : this->chunk_capacity;
+        chunk = malloc(sizeof(string_arena_chunk_t) + capacity);
+        if (!chunk) {
+            fprintf(stderr, "malloc NULL return in string_arena_allocate for capacity %lu\n", capacity);
+            return NULL;
+        }
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        if (dedicated && this->head) {
+            chunk->next = this->head->next;
+            this->head->next = chunk;
+        } else {
+            chunk->next = this->head;
+            this->head = chunk;
+            if (this->chunk_capacity < STRING_ARENA_CHUNK_MAX) {
+                this->chunk_capacity <<= 1;
+            }
+        }
+    }
+    void *const allocation = chunk->buffer + chunk->used;
+    chunk->used += size;
+    this->size += size;
+    return allocation;
+}
+
+[[nodiscard]] static string_control_block_t *string_control_block_init(
+    string_arena_t *const arena,
+    const size_t capacity
+) {
     assert(capacity > 0);
-    string_control_block_t *const control_block = malloc(sizeof(string_control_block_t));
+    string_control_block_t *const control_block = arena
+        ? string_arena_allocate(arena, sizeof(string_control_block_t) + capacity)
+        : malloc(sizeof(string_control_block_t) + capacity);
     if (!control_block) {
-        fprintf(stderr, "malloc NULL return in string_control_block_init for size %lu\n", sizeof(string_control_block_t));
+        fprintf(stderr, "malloc NULL return in string_control_block_init for capacity %lu\n", capacity);
         return NULL;
     }
+#ifdef STRING_ATOMIC_REF_COUNTER
+    atomic_init(&control_block->ref_counter, 1);
+    atomic_init(&control_block->hash, 0);
+#else
     control_block->ref_counter = 1;
-    control_block->buffer = NULL;
+    control_block->hash = 0;
+#endif
     control_block->capacity = capacity;
-    char *buffer = malloc(capacity);
-    if (!buffer) {
-        fprintf(stderr, "malloc NULL return in string_control_block_init for capacity %lu\n", capacity);
+    control_block->size = 0;
+    control_block->data = control_block->buffer;
+    control_block->mapped = 0;
+    control_block->arena = arena;
+    return control_block;
+}
+
+// heap strings edits allocate from the same arena, inline strings have none
+[[nodiscard]] static inline string_arena_t *string_arena_of(const string_t *const this) {
+    return this->size > STRING_SMALL_SIZE_MAX ? this->control_block->arena : NULL;
+}
+
+// unique ownership only, falls back to the exact size if capacity can not be allocated
+[[nodiscard]] static unsigned char string_control_block_resize(
+    string_t *const this,
+    size_t capacity,
+    const size_t size
+) {
+    assert(this->control_block && string_control_block_writable(this->control_block) && !this->offset && size < capacity);
+    if (this->control_block->arena) { // moving into a new arena block, the old one is reclaimed on reset
+        if (capacity <= this->control_block->capacity) { // shrinking keeps the block, a new one would only grow the arena
+            return 1;
+        }
+        string_control_block_t *const control_block = string_control_block_init(this->control_block->arena, capacity);
+        if (!control_block) {
+            return 0;
+        }
+        memcpy(control_block->buffer, this->control_block->buffer, this->size < size ? this->size : size);
+        this->control_block = control_block;
+        return 1;
+    }
+    string_control_block_t *control_block = realloc(this->control_block, sizeof(string_control_block_t) + capacity);
+    if (!control_block) {
+        fprintf(stderr, "realloc NULL return in string_control_block_resize for capacity %lu\n", capacity);
+        capacity = size + 1; // retrying with exact necessary capacity
+        control_block = realloc(this->control_block, sizeof(string_control_block_t) + capacity);
+    }
+    if (!control_block) {
+        fprintf(stderr, "realloc NULL return in string_control_block_resize for capacity %lu\n", capacity);
+        return 0;
+    }
+    control_block->capacity = capacity;
+    control_block->data = control_block->buffer;
+    this->control_block = control_block;
+    return 1;
+}
+
+// heap string characters start at the offset into a possibly shared control block
+[[nodiscard]] static inline char *string_buffer(const string_t *const this) {
+    return this->size <= STRING_SMALL_SIZE_MAX ? (char *)this->buffer : this->control_block->data + this->offset;
+}
+
+// ends every edit, terminating the characters and dropping the cached hash of the edited block
+static inline void string_modified(string_t *const this) {
+    string_buffer(this)[this->size] = '\0';
+    if (this->size > STRING_SMALL_SIZE_MAX) {
+        assert(string_control_block_writable(this->control_block));
+        this->control_block->size = this->size;
+#ifdef STRING_ATOMIC_REF_COUNTER
+        atomic_store_explicit(&this->control_block->hash, 0, memory_order_relaxed);
+#else
+        this->control_block->hash = 0;
+#endif
+    }
+}
+
+// unique owners of a slice move the characters to the control block start before editing in place
+static void string_control_block_rebase(string_t *const this) {
+    if (this->offset) {
+        memmove(this->control_block->buffer, this->control_block->buffer + this->offset, this->size);
+        this->offset = 0;
+    }
+}
+
+// characters editable in place, lazily copied if shared, NULL on copy failure
+[[nodiscard]] static char *string_unshare(string_t *const this) {
+    if (this->size <= STRING_SMALL_SIZE_MAX) {
+        return this->buffer;
+    }
+    if (!string_control_block_writable(this->control_block)) { // lazy copy
+        string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), this->size << 1);
+        if (!control_block) {
+            return NULL;
+        }
+        memcpy(control_block->buffer, string_buffer(this), this->size);
+        string_control_block_release(this->control_block);
+        this->control_block = control_block;
+        this->offset = 0;
+        string_modified(this);
+    } else { // unique ownership
+        string_control_block_rebase(this);
+    }
+    return this->control_block->buffer;
+}
+
+// makes this a new unshared string of size characters to be written, NULL leaves it empty
+[[nodiscard]] static char *string_prepare(
+    string_t *const this,
+    string_arena_t *const arena,
+    const size_t size,
+    const size_t capacity
+) {
+    this->size = 0;
+    this->control_block = NULL;
+    this->offset = 0;
+    if (size <= STRING_SMALL_SIZE_MAX) {
+        this->size = size;
+        this->buffer[size] = '\0';
+        return this->buffer;
+    }
+    assert(capacity > size);
+    string_control_block_t *const control_block = string_control_block_init(arena, capacity);
+    if (!control_block) {
         return NULL;
     }
-    control_block->buffer = buffer;
-    return control_block;
+    this->control_block = control_block;
+    this->size = size;
+    string_modified(this);
+    return control_block->buffer;
 }
 
 [[nodiscard]] string_t string_init(const char *const cstr) {
+    if (!cstr) {
+        return string_init_n(NULL, 0);
+    }
+    return string_init_n(cstr, strlen(cstr));
+}
+
+[[nodiscard]] string_t string_init_n(
+    const char *const data,
+    const size_t size
+) {
     string_t this = {
         .size = 0,
         .control_block = NULL
     };
-    if (!cstr) {
+    if (!data || !size) {
+        this.buffer[0] = '\0';
         return this;
     }
-    const size_t size = strlen(cstr);
-    if (size <= sizeof(this.buffer)) {
-        memcpy(this.buffer, cstr, size);
-    } else {
-        string_control_block_t *const control_block = string_control_block_init(size << 1);
-        if (!control_block) {
-            return this;
+    char *const buffer = string_prepare(&this, NULL, size, size << 1);
+    if (buffer) {
+        memcpy(buffer, data, size);
+    }
+    return this;
+}
+
+[[nodiscard]] string_t string_init_in(
+    string_arena_t *const restrict arena,
+    const char *const restrict data,
+    const size_t size
+) {
+    string_t this = {
+        .size = 0,
+        .control_block = NULL
+    };
+    if (!data || !size) {
+        this.buffer[0] = '\0';
+        return this;
+    }
+    char *const buffer = string_prepare(&this, arena, size, size + 1);
+    if (buffer) {
+        memcpy(buffer, data, size);
+    }
+    return this;
+}
+
+[[nodiscard]] string_t string_from_file_mmap(const char *const path) {
+    string_t this = {
+        .size = 0,
+        .control_block = NULL
+    };
+    this.buffer[0] = '\0';
+    if (!path) {
+        return this;
+    }
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "open failure in string_from_file_mmap for path %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return this;
+    }
+    const size_t size = (size_t)st.st_size;
+    if (size <= STRING_SMALL_SIZE_MAX) { // file fits on stack, read instead
+        size_t read_size = 0;
+        while (read_size < size) {
+            const ssize_t count = read(fd, this.buffer + read_size, size - read_size);
+            if (count <= 0) {
+                break;
+            }
+            read_size += (size_t)count;
+        }
+        close(fd);
+        this.size = read_size;
+        this.buffer[read_size] = '\0';
+        return this;
+    }
+    // the file mapped over zeroed anonymous pages, a page multiple size file still ends with NUL
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t mapped = (size + page) / page * page;
+    char *const data = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED || mmap(data, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        fprintf(stderr, "mmap failure in string_from_file_mmap for path %s\n", path);
+        if (data != MAP_FAILED) {
+            munmap(data, mapped);
         }
-        this.control_block = control_block;
-        memcpy(control_block->buffer, cstr, size);
+        close(fd);
+        return this;
+    }
+    close(fd);
+    string_control_block_t *const control_block = string_control_block_init(NULL, 1);
+    if (!control_block) {
+        munmap(data, mapped);
+        return this;
     }
+    control_block->capacity = size + 1;
+    control_block->size = size;
+    control_block->data = data;
+    control_block->mapped = mapped;
+    this.control_block = control_block;
+    this.offset = 0;
     this.size = size;
     return this;
 }
@@ -72,14 +408,14 @@ void string_insert(
         return;
     }
     const size_t size = this->size + other->size;
-    if (size <= sizeof(this->buffer)) { // new string fits on stack
+    if (size <= STRING_SMALL_SIZE_MAX) { // new string fits on stack
         char *const insertion = this->buffer + index;
-        memcpy(insertion + other->size, insertion, this->size - index);
+        memmove(insertion + other->size, insertion, this->size - index);
         memcpy(insertion, other->buffer, other->size);
     } else { // new string needs heap
-        const char *const other_buffer = other->size <= sizeof(other->buffer) ? other->buffer : other->control_block->buffer;
-        if (this->size <= sizeof(this->buffer)) { // this string fits on stack
-            string_control_block_t *const control_block = string_control_block_init(size << 1);
+        const char *const other_buffer = string_buffer(other);
+        if (this->size <= STRING_SMALL_SIZE_MAX) { // this string fits on stack
+            string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), size << 1);
             if (!control_block) {
                 return;
             }
@@ -87,41 +423,35 @@ void string_insert(
             memcpy(control_block->buffer + index, other_buffer, other->size);
             memcpy(control_block->buffer + index + other->size, this->buffer + index, this->size - index);
             this->control_block = control_block;
+            this->offset = 0;
         } else { // this string needs heap
-            assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter);
-            if (this->control_block->ref_counter > 1) { // lazy copy
-                string_control_block_t *const control_block = string_control_block_init(size << 1);
+            assert(this->control_block && this->control_block->capacity && string_control_block_owners(this->control_block));
+            if (!string_control_block_writable(this->control_block)) { // lazy copy
+                string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), size << 1);
                 if (!control_block) {
                     return;
                 }
-                memcpy(control_block->buffer, this->control_block->buffer, index);
+                const char *const buffer = string_buffer(this);
+                memcpy(control_block->buffer, buffer, index);
                 memcpy(control_block->buffer + index, other_buffer, other->size);
-                memcpy(control_block->buffer + index + other->size, this->control_block->buffer + index, this->size - index);
-                --this->control_block->ref_counter;
+                memcpy(control_block->buffer + index + other->size, buffer + index, this->size - index);
+                string_control_block_release(this->control_block);
                 this->control_block = control_block;
+                this->offset = 0;
             } else { // unique ownership
-                if (this->control_block->capacity < size) { // realloc
-                    size_t capacity = size << 1; // double the capacity in advance
-                    char *buffer = realloc(this->control_block->buffer, capacity);
-                    if (!buffer) {
-                        fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                        capacity = size; // retrying with exact necessary capacity
-                        buffer = realloc(this->control_block->buffer, capacity);
-                    }
-                    if (!buffer) {
-                        fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                        return;
-                    }
-                    this->control_block->buffer = buffer;
-                    this->control_block->capacity = capacity;
+                string_control_block_rebase(this);
+                // realloc, doubling the capacity in advance
+                if (this->control_block->capacity <= size && !string_control_block_resize(this, size << 1, size)) {
+                    return;
                 }
                 char *const insertion = this->control_block->buffer + index;
-                memcpy(insertion + other->size, insertion, this->size - index);
+                memmove(insertion + other->size, insertion, this->size - index);
                 memcpy(insertion, other_buffer, other->size);
             }
         }
     }
     this->size = size;
+    string_modified(this);
 }
 
 void string_rconcat(
@@ -152,51 +482,42 @@ void string_remove(
         count = end - index;
     }
     const size_t size = this->size - count;
-    if (this->size <= sizeof(this->buffer)) { // this string fits on stack
+    if (this->size <= STRING_SMALL_SIZE_MAX) { // this string fits on stack
         char *const removal = this->buffer + index;
-        memcpy(removal, removal + count, this->size - end);
+        memmove(removal, removal + count, this->size - end);
     } else { // this string needs heap
-        assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter);
-        if (size <= sizeof(this->buffer)) { // new string fits on stack
+        assert(this->control_block && this->control_block->capacity && string_control_block_owners(this->control_block));
+        if (size <= STRING_SMALL_SIZE_MAX) { // new string fits on stack
             string_control_block_t *const control_block = this->control_block;
-            memcpy(this->buffer, control_block->buffer, index);
-            memcpy(this->buffer + index, control_block->buffer + index + count, this->size - end);
-            if (!--control_block->ref_counter) { // freeing control block
-                free(control_block->buffer);
-                free(control_block);
-            }
+            const char *const buffer = string_buffer(this);
+            memcpy(this->buffer, buffer, index);
+            memcpy(this->buffer + index, buffer + index + count, this->size - end);
+            string_control_block_release(control_block);
         } else { // new string needs heap
-            if (this->control_block->ref_counter > 1) { // lazy copy
-                string_control_block_t *const control_block = string_control_block_init(size << 1);
+            if (!string_control_block_writable(this->control_block)) { // lazy copy
+                string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), size << 1);
                 if (!control_block) {
                     return;
                 }
-                memcpy(control_block->buffer, this->control_block->buffer, index);
-                memcpy(control_block->buffer + index, this->control_block->buffer + index + count, this->size - end);
-                --this->control_block->ref_counter;
+                const char *const buffer = string_buffer(this);
+                memcpy(control_block->buffer, buffer, index);
+                memcpy(control_block->buffer + index, buffer + index + count, this->size - end);
+                string_control_block_release(this->control_block);
                 this->control_block = control_block;
+                this->offset = 0;
             } else { // unique ownership
-                if (size < this->control_block->capacity >> 2) { // realloc
-                    size_t capacity = this->size << 1; // half the capacity
-                    char *buffer = realloc(this->control_block->buffer, capacity);
-                    if (!buffer) {
-                        fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                        capacity = size; // retrying with exact necessary capacity
-                        buffer = realloc(this->control_block->buffer, capacity);
-                    }
-                    if (!buffer) {
-                        fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                        return;
-                    }
-                    this->control_block->buffer = buffer;
-                    this->control_block->capacity = capacity;
-                }
+                string_control_block_rebase(this);
                 char *const removal = this->control_block->buffer + index;
-                memcpy(removal, removal + count, this->size - end);
+                memmove(removal, removal + count, this->size - end);
+                // realloc, halving the capacity, the old block still fits if that fails
+                if (size < this->control_block->capacity >> 2) {
+                    (void)string_control_block_resize(this, size << 1, size);
+                }
             }
         }
     }
     this->size = size;
+    string_modified(this);
 }
 
 void string_rtrim(
@@ -219,15 +540,57 @@ void string_ltrim(
     string_remove(this, 0, count);
 }
 
-[[nodiscard]] static signed char compare_char(
-    const char a,
-    const char b,
-    const unsigned char case_insensitive
+[[nodiscard]] static inline unsigned char fold_char(const unsigned char c) {
+    return (unsigned char)(c - 'A') < 26u ? c | 0x20 : c;
+}
+
+[[nodiscard]] static inline unsigned char is_alpha_char(const unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26u;
+}
+
+// ASCII case bit flipped for the 26 letters from first, other bytes are kept
+#ifdef __AVX2__
+[[nodiscard]] static inline __m256i flip_case_256(const __m256i block, const char first) {
+    // signed comparison of the byte distance from first biased by 128
+    const __m256i biased = _mm256_sub_epi8(block, _mm256_set1_epi8((char)(first - 128)));
+    const __m256i letters = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26), biased);
+    return _mm256_xor_si256(block, _mm256_and_si256(letters, _mm256_set1_epi8(0x20)));
+}
+#endif
+
+#ifdef __SSE2__
+[[nodiscard]] static inline __m128i flip_case_128(const __m128i block, const char first) {
+    // signed comparison of the byte distance from first biased by 128
+    const __m128i biased = _mm_sub_epi8(block, _mm_set1_epi8((char)(first - 128)));
+    const __m128i letters = _mm_cmpgt_epi8(_mm_set1_epi8(-128 + 26), biased);
+    return _mm_xor_si128(block, _mm_and_si128(letters, _mm_set1_epi8(0x20)));
+}
+#endif
+
+// copies size bytes flipping the case of letters from first, 'A' lowers and 'a' uppers
+static void convert_case(
+    char *const destination,
+    const char *const source,
+    const size_t size,
+    const char first
 ) {
-    if (case_insensitive) {
-        return (signed char)(tolower(a) - tolower(b));
+    size_t i = 0;
+#ifdef __AVX2__
+    for (; i + 32 <= size; i += 32) {
+        const __m256i block = _mm256_loadu_si256((const __m256i *)(source + i));
+        _mm256_storeu_si256((__m256i *)(destination + i), flip_case_256(block, first));
+    }
+#endif
+#ifdef __SSE2__
+    for (; i + 16 <= size; i += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i *)(source + i));
+        _mm_storeu_si128((__m128i *)(destination + i), flip_case_128(block, first));
+    }
+#endif
+    for (; i < size; ++i) {
+        const unsigned char c = source[i];
+        destination[i] = (char)((unsigned char)(c - first) < 26u ? c ^ 0x20 : c);
     }
-    return (signed char)(a - b);
 }
 
 [[nodiscard]] static int compare_string(
@@ -236,14 +599,40 @@ void string_ltrim(
     const size_t len,
     const unsigned char case_insensitive
 ) {
+    if (!len) {
+        return 0;
+    }
     assert(a != NULL && b != NULL);
     // case sensitive comparison
     if (!case_insensitive) {
         return memcmp(a, b, len);
     }
-    // case insensitive comparison
-    for (size_t i = 0ul; i < len; ++i) {
-        const int diff = tolower(a[i]) - tolower(b[i]);
+    // case insensitive comparison, only ASCII letters fold
+    size_t i = 0ul;
+#ifdef __AVX2__
+    for (; i + 32 <= len; i += 32) {
+        const __m256i a_block = flip_case_256(_mm256_loadu_si256((const __m256i *)(a + i)), 'A');
+        const __m256i b_block = flip_case_256(_mm256_loadu_si256((const __m256i *)(b + i)), 'A');
+        const unsigned int equal = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a_block, b_block));
+        if (equal != 0xffffffffu) {
+            i += (unsigned int)__builtin_ctz(~equal);
+            return fold_char(a[i]) - fold_char(b[i]);
+        }
+    }
+#endif
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        const __m128i a_block = flip_case_128(_mm_loadu_si128((const __m128i *)(a + i)), 'A');
+        const __m128i b_block = flip_case_128(_mm_loadu_si128((const __m128i *)(b + i)), 'A');
+        const unsigned int equal = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(a_block, b_block));
+        if (equal != 0xffffu) {
+            i += (unsigned int)__builtin_ctz(~equal);
+            return fold_char(a[i]) - fold_char(b[i]);
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        const int diff = fold_char(a[i]) - fold_char(b[i]);
         if (diff != 0ul) {
             return diff;
         }
@@ -251,6 +640,164 @@ void string_ltrim(
     return 0;
 }
 
+// Horspool bad character shifts, backward ones when reverse is set
+static void string_search_shifts(
+    size_t *const shifts,
+    const char *const needle,
+    const size_t needle_len,
+    const unsigned char case_insensitive,
+    const unsigned char reverse
+) {
+    for (size_t c = 0; c < 256; ++c) {
+        shifts[c] = needle_len;
+    }
+    for (size_t i = 0; i + 1 < needle_len; ++i) {
+        const size_t shift = needle_len - 1 - i;
+        const unsigned char c = reverse ? needle[shift] : needle[i];
+        shifts[c] = shift;
+        if (case_insensitive && is_alpha_char(c)) {
+            shifts[c ^ 0x20] = shift;
+        }
+    }
+}
+
+// first and last needle bytes filter candidates, the middle is compared for them only
+[[nodiscard]] static size_t string_search_filter(
+    const char *const haystack,
+    const size_t haystack_len,
+    const char *const needle,
+    const size_t needle_len,
+    const unsigned char case_insensitive,
+    const unsigned char reverse
+) {
+    const unsigned char first = case_insensitive ? fold_char(needle[0]) : needle[0];
+    const unsigned char last = case_insensitive ? fold_char(needle[needle_len - 1]) : needle[needle_len - 1];
+    // letters are compared with the case bit set on both sides
+    const unsigned char first_fold = case_insensitive && is_alpha_char(first) ? 0x20 : 0;
+    const unsigned char last_fold = case_insensitive && is_alpha_char(last) ? 0x20 : 0;
+    const size_t middle_len = needle_len > 2 ? needle_len - 2 : 0;
+    const size_t positions = haystack_len - needle_len + 1;
+    size_t l = 0;
+    size_t r = positions;
+#ifdef __SSE2__
+    const __m128i first_mask = _mm_set1_epi8((char)first_fold);
+    const __m128i last_mask = _mm_set1_epi8((char)last_fold);
+    const __m128i first_block = _mm_set1_epi8((char)first);
+    const __m128i last_block = _mm_set1_epi8((char)last);
+    while (r - l >= 16) {
+        const size_t block = reverse ? r - 16 : l;
+        const __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i *)(haystack + block)), first_mask);
+        const __m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i *)(haystack + block + needle_len - 1)), last_mask);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first_block), _mm_cmpeq_epi8(b, last_block))
+        );
+        while (mask) {
+            const unsigned int bit = reverse ? 31u - (unsigned int)__builtin_clz(mask) : (unsigned int)__builtin_ctz(mask);
+            if (!compare_string(haystack + block + bit + 1, needle + 1, middle_len, case_insensitive)) {
+                return block + bit;
+            }
+            mask ^= 1u << bit;
+        }
+        if (reverse) {
+            r -= 16;
+        } else {
+            l += 16;
+        }
+    }
+#endif
+    while (l < r) {
+        const size_t i = reverse ? --r : l++;
+        if (((unsigned char)haystack[i] | first_fold) == first
+            && ((unsigned char)haystack[i + needle_len - 1] | last_fold) == last
+            && !compare_string(haystack + i + 1, needle + 1, middle_len, case_insensitive)) {
+            return i;
+        }
+    }
+    return STRING_NPOS;
+}
+
+[[nodiscard]] static size_t string_search_horspool(
+    const char *const haystack,
+    const size_t haystack_len,
+    const char *const needle,
+    const size_t needle_len,
+    const unsigned char case_insensitive
+) {
+    size_t shifts[256];
+    string_search_shifts(shifts, needle, needle_len, case_insensitive, 0);
+    const unsigned char last = case_insensitive ? fold_char(needle[needle_len - 1]) : needle[needle_len - 1];
+    for (size_t i = 0; i + needle_len <= haystack_len; ) {
+        const unsigned char c = haystack[i + needle_len - 1];
+        if ((case_insensitive ? fold_char(c) : c) == last
+            && !compare_string(haystack + i, needle, needle_len - 1, case_insensitive)) {
+            return i;
+        }
+        i += shifts[c];
+    }
+    return STRING_NPOS;
+}
+
+[[nodiscard]] static size_t string_rsearch_horspool(
+    const char *const haystack,
+    const size_t haystack_len,
+    const char *const needle,
+    const size_t needle_len,
+    const unsigned char case_insensitive
+) {
+    size_t shifts[256];
+    string_search_shifts(shifts, needle, needle_len, case_insensitive, 1);
+    const unsigned char first = case_insensitive ? fold_char(needle[0]) : needle[0];
+    for (size_t i = haystack_len - needle_len; ; ) {
+        const unsigned char c = haystack[i];
+        if ((case_insensitive ? fold_char(c) : c) == first
+            && !compare_string(haystack + i + 1, needle + 1, needle_len - 1, case_insensitive)) {
+            return i;
+        }
+        if (i < shifts[c]) {
+            return STRING_NPOS;
+        }
+        i -= shifts[c];
+    }
+}
+
+// position of the first needle occurrence or STRING_NPOS
+[[nodiscard]] static size_t string_search(
+    const char *const haystack,
+    const size_t haystack_len,
+    const char *const needle,
+    const size_t needle_len,
+    const unsigned char case_insensitive
+) {
+    if (!needle_len || needle_len > haystack_len) {
+        return STRING_NPOS;
+    }
+    if (needle_len == 1 && !(case_insensitive && is_alpha_char(needle[0]))) {
+        const char *const found = memchr(haystack, needle[0], haystack_len);
+        return found ? (size_t)(found - haystack) : STRING_NPOS;
+    }
+    if (needle_len < STRING_SEARCH_HORSPOOL_MIN) {
+        return string_search_filter(haystack, haystack_len, needle, needle_len, case_insensitive, 0);
+    }
+    return string_search_horspool(haystack, haystack_len, needle, needle_len, case_insensitive);
+}
+
+// position of the last needle occurrence or STRING_NPOS
+[[nodiscard]] static size_t string_rsearch(
+    const char *const haystack,
+    const size_t haystack_len,
+    const char *const needle,
+    const size_t needle_len,
+    const unsigned char case_insensitive
+) {
+    if (!needle_len || needle_len > haystack_len) {
+        return STRING_NPOS;
+    }
+    if (needle_len < STRING_SEARCH_HORSPOOL_MIN) {
+        return string_search_filter(haystack, haystack_len, needle, needle_len, case_insensitive, 1);
+    }
+    return string_rsearch_horspool(haystack, haystack_len, needle, needle_len, case_insensitive);
+}
+
 void string_rtrim_like(
     string_t *const restrict this,
     const char *const restrict like,
@@ -263,7 +810,7 @@ void string_rtrim_like(
     if (!like_len || like_len > this->size) {
         return;
     }
-    const char *const current_buffer = this->size <= sizeof(this->buffer) ? this->buffer : this->control_block->buffer;
+    const char *const current_buffer = string_buffer(this);
     size_t trim_size = 0;
     while (this->size - trim_size >= like_len) {
         if (compare_string(current_buffer + this->size - like_len - trim_size, like, like_len, case_insensitive)) { // no match
@@ -286,7 +833,7 @@ void string_ltrim_like(
     if (!like_len || like_len > this->size) {
         return;
     }
-    const char *const current_buffer = this->size <= sizeof(this->buffer) ? this->buffer : this->control_block->buffer;
+    const char *const current_buffer = string_buffer(this);
     size_t trim_size = 0;
     while (this->size - trim_size >= like_len) {
         if (compare_string(current_buffer + trim_size, like, like_len, case_insensitive)) { // no match
@@ -314,20 +861,10 @@ void string_set(
     if (!this || index >= this->size) {
         return;
     }
-    if (this->size <= sizeof(this->buffer)) { // this string fits on stack
-        this->buffer[index] = c;
-    } else { // this string needs heap
-        assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter);
-        if (this->control_block->ref_counter > 1) { // lazy copy
-            string_control_block_t *const control_block = string_control_block_init(this->control_block->capacity);
-            if (!control_block) {
-                return;
-            }
-            memcpy(control_block->buffer, this->control_block->buffer, this->size);
-            --this->control_block->ref_counter;
-            this->control_block = control_block;
-        }
-        this->control_block->buffer[index] = c;
+    char *const buffer = string_unshare(this);
+    if (buffer) {
+        buffer[index] = c;
+        string_modified(this);
     }
 }
 
@@ -338,7 +875,7 @@ void string_set(
     if (!this || index >= this->size) {
         return '\0';
     }
-    return this->size <= sizeof(this->buffer) ? this->buffer[index] : this->control_block->buffer[index];
+    return string_buffer(this)[index];
 }
 
 [[nodiscard]] string_t string_copy(const string_t *const this) {
@@ -349,10 +886,9 @@ void string_set(
     if (!this) {
         return copy;
     }
-    copy.control_block = this->control_block;
-    copy.size = this->size;
-    if (this->size > sizeof(this->buffer)) {
-        ++this->control_block->ref_counter;
+    copy = *this;
+    if (this->size > STRING_SMALL_SIZE_MAX) {
+        string_control_block_share(this->control_block);
     }
     return copy;
 }
@@ -374,16 +910,13 @@ void string_set(
         end = this->size;
         count = end - index;
     }
-    const char *const buffer = this->size <= sizeof(this->buffer) ? this->buffer : this->control_block->buffer;
-    if (count <= sizeof(substring.buffer)) { // substring fits on stack
-        memcpy(substring.buffer, buffer + index, count);
-    } else { // substring needs heap
-        string_control_block_t *const control_block = string_control_block_init(count << 1);
-        if (!control_block) {
-            return substring;
-        }
-        memcpy(control_block->buffer, buffer + index, count);
-        substring.control_block = control_block;
+    if (count <= STRING_SMALL_SIZE_MAX) { // substring fits on stack
+        memcpy(substring.buffer, string_buffer(this) + index, count);
+        substring.buffer[count] = '\0';
+    } else { // substring shares the heap string control block
+        string_control_block_share(this->control_block);
+        substring.control_block = this->control_block;
+        substring.offset = this->offset + index;
     }
     substring.size = count;
     return substring;
@@ -401,38 +934,9 @@ void string_set(
     if (!str_len || str_len > this->size) {
         return -1;
     }
-    // calculating str hash
-    size_t str_hash = 0;
-    for (size_t i = 0; i < str_len; ++i) {
-        // h += c_{i} * 2^{l - i - 1} mod 256
-        const int ci = case_insensitive ? tolower(str[i]) : str[i];
-        str_hash = (str_hash + (ci << (str_len - i - 1))) & (-1ul >> RK_SHIFT);
-    }
-    // calculating initial string hash
-    const char *const buffer = this->size <= sizeof(this->buffer) ? this->buffer : this->control_block->buffer;
-    size_t hash = 0;
-    for (size_t i = 0; i < str_len; ++i) {
-        const int ci = case_insensitive ? tolower(buffer[i]) : buffer[i];
-        hash = (hash + (ci << (str_len - i - 1))) & (-1ul >> RK_SHIFT);
-    }
-    // looking for str in initial string
-    long long start = 0;
-    for (;;) {
-        // replacing if from found
-        if (hash == str_hash && !compare_string(buffer + start, str, str_len, case_insensitive)) { // checking hash collision
-            return start;
-        }
-        if (start + str_len > this->size) {
-            break;
-        }
-        // recalculating hash
-        const int start_char = case_insensitive ? tolower(buffer[start]) : buffer[start];
-        const int end_char = case_insensitive ? tolower(buffer[start + str_len]) : buffer[start + str_len];
-        // h_{i + 1} = (h_{i} - c_{i} * 2^{l - 1}) * 2 + c_{i + l} mod 256
-        hash = (((hash + (RK_M - (start_char << (str_len - 1)) & (-1ul >> RK_SHIFT)) & (-1ul >> RK_SHIFT)) << 1) + end_char) & (-1ul >> RK_SHIFT);
-        ++start;
-    }
-    return -1;
+    const char *const buffer = string_buffer(this);
+    const size_t position = string_search(buffer, this->size, str, str_len, case_insensitive);
+    return position == STRING_NPOS ? -1 : (long long)position;
 }
 
 [[nodiscard]] long long string_rfind(
@@ -447,37 +951,9 @@ void string_set(
     if (!str_len || str_len > this->size) {
         return -1;
     }
-    // calculating str hash
-    size_t str_hash = 0;
-    for (size_t i = 0; i < str_len; ++i) {
-        // h += c_{i} * 2^{l - i - 1} mod 256
-        const int ci = case_insensitive ? tolower(str[i]) : str[i];
-        str_hash = (str_hash + (ci << (str_len - i - 1))) & (-1ul >> RK_SHIFT);
-    }
-    // substring borders
-    long long start = (long long)this->size - (long long)str_len;
-    // calculating initial string hash
-    const char *const buffer = this->size <= sizeof(this->buffer) ? this->buffer : this->control_block->buffer;
-    size_t hash = 0;
-    for (size_t i = 0; i < str_len; ++i) {
-        const int ci = case_insensitive ? tolower(buffer[i]) : buffer[i];
-        hash = (hash + (ci << (str_len - i - 1))) & (-1ul >> RK_SHIFT);
-    }
-    // looking for str in initial string
-    for (;;) {
-        if (hash == str_hash && !compare_string(buffer + start, str, str_len, case_insensitive)) { // checking hash collision
-            return start;
-        }
-        if (--start < 0) {
-            break;
-        }
-        // recalculating hash
-        const int start_char = case_insensitive ? tolower(buffer[start]) : buffer[start];
-        const int end_char = case_insensitive ? tolower(buffer[start + str_len]) : buffer[start + str_len];
-        // h_{i - 1} = (h_{i} - c_{i + l - 1}) / 2 + c_{i - 1} * 2^{l - 1} mod 256
-        hash = (((hash  + (RK_M - (end_char & (-1ul >> RK_SHIFT))) & (-1ul >> RK_SHIFT)) >> 1) + (start_char << (str_len - 1))) & (-1ul >> RK_SHIFT);
-    }
-    return -1;
+    const char *const buffer = string_buffer(this);
+    const size_t position = string_rsearch(buffer, this->size, str, str_len, case_insensitive);
+    return position == STRING_NPOS ? -1 : (long long)position;
 }
 
 void string_replace(
@@ -494,125 +970,98 @@ void string_replace(
         return;
     }
     const size_t to_len = strlen(to);
-    const long long len_diff = (long long)to_len - (long long)from_len;
-    const unsigned char is_small = this->size <= sizeof(this->buffer);
-    char *current_buffer = is_small ? this->buffer : this->control_block->buffer;
-    size_t start = 0;
-    if (len_diff > 0) { // new string will be bigger
-        while (start + from_len <= this->size) {
-            if (compare_string(current_buffer + start, from, from_len, case_insensitive)) {
-                ++start;
-            } else {
-                const size_t new_size = this->size + len_diff;
-                if (this->size <= sizeof(this->buffer)) { // this string fits on stack
-                    if (new_size > sizeof(this->buffer)) { // new string needs heap
-                        string_control_block_t *const control_block = string_control_block_init(new_size << 1);
-                        if (!control_block) {
-                            return;
-                        }
-                        memcpy(control_block->buffer, this->buffer, start);
-                        memcpy(control_block->buffer + start, to, to_len);
-                        memcpy(control_block->buffer + start + to_len, this->buffer + start + from_len, this->size - start - from_len);
-                        this->control_block = control_block;
-                        start += to_len;
-                        this->size += len_diff;
-                        current_buffer = control_block->buffer;
-                        continue;
-                    }
-                } else { // this string needs heap
-                    assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter);
-                    if (this->control_block->ref_counter > 1) { // lazy copy
-                        string_control_block_t *const control_block = string_control_block_init(new_size << 1);
-                        if (!control_block) {
-                            return;
-                        }
-                        memcpy(control_block->buffer, this->control_block->buffer, start);
-                        memcpy(control_block->buffer + start, to, to_len);
-                        memcpy(control_block->buffer + start + to_len, this->control_block->buffer + start + from_len, this->size - start - from_len);
-                        --this->control_block->ref_counter;
-                        this->control_block = control_block;
-                        start += to_len;
-                        this->size += len_diff;
-                        current_buffer = control_block->buffer;
-                        continue;
-                    } // unique ownership
-                    if (this->control_block->capacity < new_size) { // realloc
-                        size_t capacity = new_size << 1; // double the capacity in advance
-                        char *buffer = realloc(this->control_block->buffer, capacity);
-                        if (!buffer) {
-                            fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                            capacity = new_size; // retrying with exact necessary capacity
-                            buffer = realloc(this->control_block->buffer, capacity);
-                        }
-                        if (!buffer) {
-                            fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                            return;
-                        }
-                        this->control_block->buffer = buffer;
-                        this->control_block->capacity = capacity;
-                        current_buffer = buffer;
-                    }
-                }
-                char *const replacement = current_buffer + start;
-                memcpy(replacement + to_len, replacement + from_len, this->size - start - from_len);
-                memcpy(replacement, to, to_len);
-                start += to_len;
-                this->size += len_diff;
-            }
+    const unsigned char is_small = this->size <= STRING_SMALL_SIZE_MAX;
+    char *const current_buffer = string_buffer(this);
+    // collecting match positions first, so the result is sized and allocated once
+    size_t matches_stack_buffer[STRING_REPLACE_STACK_MATCHES];
+    size_t *matches = matches_stack_buffer;
+    size_t matches_capacity = STRING_REPLACE_STACK_MATCHES;
+    size_t matches_count = 0;
+    for (size_t start = 0; start + from_len <= this->size; ) {
+        const size_t position = string_search(current_buffer + start, this->size - start, from, from_len, case_insensitive);
+        if (position == STRING_NPOS) {
+            break;
         }
-    } else {
-        while (start + from_len <= this->size) {
-            if (compare_string(current_buffer + start, from, from_len, case_insensitive)) { // no match
-                ++start;
-            } else {
-                if (this->size > sizeof(this->buffer) && this->control_block->ref_counter > 1) { // this string needs heap
-                    // lazy copy
-                    string_control_block_t *const control_block = string_control_block_init((this->size + len_diff) << 1);
-                    if (!control_block) {
-                        return;
-                    }
-                    memcpy(control_block->buffer, this->control_block->buffer, start);
-                    memcpy(control_block->buffer + start + to_len, this->control_block->buffer + start + from_len, this->size - start - from_len);
-                    memcpy(control_block->buffer + start, to, to_len);
-                    --this->control_block->ref_counter;
-                    this->control_block = control_block;
-                    current_buffer = control_block->buffer;
-                } else {
-                    char *const replacement = current_buffer + start;
-                    memcpy(replacement + to_len, replacement + from_len, this->size - start - from_len);
-                    memcpy(replacement, to, to_len);
+        if (matches_count == matches_capacity) {
+            matches_capacity <<= 1;
+            size_t *const grown = matches == matches_stack_buffer
+                ? malloc(matches_capacity * sizeof(size_t))
+                : realloc(matches, matches_capacity * sizeof(size_t));
+            if (!grown) {
+                fprintf(stderr, "malloc NULL return in string_replace for %lu matches\n", matches_capacity);
+                if (matches != matches_stack_buffer) {
+                    free(matches);
                 }
-                start += to_len;
-                this->size += len_diff;
+                return;
             }
-
+            if (matches == matches_stack_buffer) {
+                memcpy(grown, matches_stack_buffer, sizeof(matches_stack_buffer));
+            }
+            matches = grown;
         }
-        if (len_diff < 0) { // new string will be smaller
-            if (!is_small && this->size <= sizeof(this->buffer)) { // new string fits on stack
-                string_control_block_t *const control_block = this->control_block;
-                memcpy(this->buffer, control_block->buffer, this->size);
-                if (!--control_block->ref_counter) { // freeing control block
-                    free(control_block->buffer);
-                    free(control_block);
-                }
-            } else { // new string needs heap
-                if (this->control_block->ref_counter == 1 && this->size < this->control_block->capacity >> 2) { // unique ownership & smaller size
-                    size_t capacity = this->size << 1; // half the capacity
-                    char *buffer = realloc(this->control_block->buffer, capacity);
-                    if (!buffer) {
-                        fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                        capacity = this->size; // retrying with exact necessary capacity
-                        buffer = realloc(this->control_block->buffer, capacity);
-                    }
-                    if (!buffer) {
-                        fprintf(stderr, "realloc NULL return in string_insert for capacity %lu\n", capacity);
-                        return;
-                    }
-                    this->control_block->buffer = buffer;
-                    this->control_block->capacity = capacity;
+        matches[matches_count++] = start + position;
+        start += position + from_len;
+    }
+    if (!matches_count) {
+        return;
+    }
+    const size_t size = this->size - matches_count * from_len + matches_count * to_len;
+    if (to_len <= from_len && (is_small || string_control_block_writable(this->control_block))) { // in place
+        char *write = current_buffer + matches[0];
+        for (size_t i = 0; i < matches_count; ++i) {
+            memcpy(write, to, to_len);
+            write += to_len;
+            const size_t kept = matches[i] + from_len;
+            const size_t kept_len = (i + 1 < matches_count ? matches[i + 1] : this->size) - kept;
+            memmove(write, current_buffer + kept, kept_len);
+            write += kept_len;
+        }
+        if (!is_small && size <= STRING_SMALL_SIZE_MAX) { // new string fits on stack
+            string_control_block_t *const control_block = this->control_block;
+            memmove(this->buffer, current_buffer, size);
+            string_control_block_release(control_block);
+        } else if (!is_small && size < this->control_block->capacity >> 2) { // smaller size
+            string_control_block_rebase(this);
+            (void)string_control_block_resize(this, size << 1, size); // half the capacity
+        }
+    } else { // single forward pass into a new buffer
+        char stack_buffer[sizeof(this->buffer)];
+        char *buffer = stack_buffer;
+        string_control_block_t *control_block = NULL;
+        if (size > STRING_SMALL_SIZE_MAX) { // new string needs heap
+            control_block = string_control_block_init(string_arena_of(this), size << 1);
+            if (!control_block) {
+                if (matches != matches_stack_buffer) {
+                    free(matches);
                 }
+                return;
             }
+            buffer = control_block->buffer;
+        }
+        char *write = buffer;
+        size_t kept = 0;
+        for (size_t i = 0; i < matches_count; ++i) {
+            memcpy(write, current_buffer + kept, matches[i] - kept);
+            write += matches[i] - kept;
+            memcpy(write, to, to_len);
+            write += to_len;
+            kept = matches[i] + from_len;
+        }
+        memcpy(write, current_buffer + kept, this->size - kept);
+        if (!is_small) {
+            string_control_block_release(this->control_block);
         }
+        if (control_block) {
+            this->control_block = control_block;
+            this->offset = 0;
+        } else {
+            memcpy(this->buffer, stack_buffer, size);
+        }
+    }
+    this->size = size;
+    string_modified(this);
+    if (matches != matches_stack_buffer) {
+        free(matches);
     }
 }
 
@@ -634,103 +1083,1472 @@ void string_replace(
     if (size_diff) {
         return size_diff;
     }
-    if (this->size <= sizeof(this->buffer)) { // this string fits on stack
-        for (size_t i = 0; i < this->size; ++i) {
-            const signed char diff = compare_char(this->buffer[i], other->buffer[i], case_insensitive);
-            if (diff) {
-                return diff;
-            }
-        }
-    } else { // this string neads heap
-        assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter
-            && other->control_block && other->control_block->capacity && other->control_block->ref_counter);
-        for (size_t i = 0; i < this->size; ++i) {
-            const signed char diff = compare_char(this->control_block->buffer[i], other->control_block->buffer[i], case_insensitive);
-            if (diff) {
-                return diff;
-            }
-        }
-    }
-    return 0;
+    return compare_string(string_buffer(this), string_buffer(other), this->size, case_insensitive);
 }
 
 [[nodiscard]] char *string_cstr(const string_t *const this) {
     if (!this) {
         return NULL;
     }
-    assert(this->control_block != NULL);
     char *cstr = malloc(this->size + 1);
-    if (this->size <= sizeof(this->buffer)) { // this string fits on stack
+    if (!cstr) {
+        fprintf(stderr, "malloc NULL return in string_cstr for size %lu\n", this->size + 1);
+        return NULL;
+    }
+    if (this->size <= STRING_SMALL_SIZE_MAX) { // this string fits on stack
         memcpy(cstr, this->buffer, this->size);
     } else { // this string neads heap
-        assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter);
-        memcpy(cstr, this->control_block->buffer, this->size);
+        assert(this->control_block && this->control_block->capacity && string_control_block_owners(this->control_block));
+        memcpy(cstr, string_buffer(this), this->size);
     }
     cstr[this->size] = '\0';
     return cstr;
 }
 
-void string_reverse(string_t *const this) {
-    if (!this || this->size < 2) {
-        return;
-    }
-    if (this->size <= sizeof(this->buffer)) { // this string fits on stack
-        char *i = this->buffer;
-        char *j = i + this->size - 1;
-        do {
-            const char tmp = *i;
-            *i = *j;
-            *j = tmp;
-        } while (++i < --j);
-    } else { // this string neads heap
-        assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter);
-        if (this->control_block->ref_counter > 1) { // lazy copy
-            string_control_block_t *const control_block = string_control_block_init(this->control_block->capacity);
-            if (!control_block) {
-                return;
-            }
-            for (size_t i = 0; i < this->size; ++i) {
-                control_block->buffer[i] = this->control_block->buffer[this->size - 1 - i];
-            }
-            --this->control_block->ref_counter;
-            this->control_block = control_block;
-        } else { // unique ownership
-            char *i = this->control_block->buffer;
-            char *j = i + this->size - 1;
-            do {
-                const char tmp = *i;
-                *i = *j;
-                *j = tmp;
-            } while (++i < --j);
-        }
+[[nodiscard]] const char *string_data(const string_t *const this) {
+    if (!this) {
+        return NULL;
     }
+    return string_buffer(this);
 }
 
-void string_delete(string_t *const this) {
+[[nodiscard]] const char *string_cstr_view(string_t *const this) {
     if (!this) {
-        return;
+        return NULL;
     }
-    if (this->size > sizeof(this->buffer)) { // this string neads heap
-        assert(this->control_block && this->control_block->capacity && this->control_block->ref_counter);
-        if (!--this->control_block->ref_counter) {
-            free(this->control_block->buffer);
-            free(this->control_block);
-        }
+    const char *const buffer = string_buffer(this);
+    if (buffer[this->size] == '\0') {
+        return buffer;
     }
-    this->size = 0;
+    // substring inside a longer string, detaching it
+    string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), this->size + 1);
+    if (!control_block) {
+        return NULL;
+    }
+    memcpy(control_block->buffer, buffer, this->size);
+    string_control_block_release(this->control_block);
+    this->control_block = control_block;
+    this->offset = 0;
+    string_modified(this);
+    return control_block->buffer;
 }
 
-void string_print(const string_t *const this) {
+void string_to_lower(string_t *const this) {
     if (!this || !this->size) {
         return;
     }
-    if (this->size <= sizeof(this->buffer)) { // this string fits on stack
-        for (size_t i = 0; i < this->size; ++i) {
-            printf("%c", this->buffer[i]);
-        }
-    } else { // this string neads heap
-        for (size_t i = 0; i < this->size; ++i) {
-            printf("%c", this->control_block->buffer[i]);
-        }
+    char *const buffer = string_unshare(this);
+    if (buffer) {
+        convert_case(buffer, buffer, this->size, 'A');
+        string_modified(this);
     }
 }
+
+void string_to_upper(string_t *const this) {
+    if (!this || !this->size) {
+        return;
+    }
+    char *const buffer = string_unshare(this);
+    if (buffer) {
+        convert_case(buffer, buffer, this->size, 'a');
+        string_modified(this);
+    }
+}
+
+#ifdef __AVX2__
+[[nodiscard]] static inline __m256i reverse_256(const __m256i block) {
+    const __m256i lanes = _mm256_shuffle_epi8(block, _mm256_setr_epi8(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+    ));
+    return _mm256_permute4x64_epi64(lanes, 0x4E); // swapping the reversed lanes
+}
+#endif
+
+#ifdef __SSE2__
+[[nodiscard]] static inline __m128i reverse_128(const __m128i block) {
+#ifdef __SSSE3__
+    return _mm_shuffle_epi8(block, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+#else
+    // dwords, then words inside them, then bytes inside words
+    __m128i reversed = _mm_shuffle_epi32(block, 0x1B);
+    reversed = _mm_shufflehi_epi16(_mm_shufflelo_epi16(reversed, 0xB1), 0xB1);
+    return _mm_or_si128(_mm_srli_epi16(reversed, 8), _mm_slli_epi16(reversed, 8));
+#endif
+}
+#endif
+
+// destination gets source reversed, swapping blocks from both ends, equal pointers reverse in place
+static void reverse_bytes(
+    char *const destination,
+    const char *const source,
+    const size_t size
+) {
+    size_t i = 0;
+    size_t j = size;
+#ifdef __AVX2__
+    for (; j - i >= 2 * sizeof(__m256i); i += sizeof(__m256i), j -= sizeof(__m256i)) {
+        const __m256i front = _mm256_loadu_si256((const __m256i *)(source + i));
+        const __m256i back = _mm256_loadu_si256((const __m256i *)(source + j - sizeof(__m256i)));
+        _mm256_storeu_si256((__m256i *)(destination + i), reverse_256(back));
+        _mm256_storeu_si256((__m256i *)(destination + j - sizeof(__m256i)), reverse_256(front));
+    }
+#endif
+#ifdef __SSE2__
+    for (; j - i >= 2 * sizeof(__m128i); i += sizeof(__m128i), j -= sizeof(__m128i)) {
+        const __m128i front = _mm_loadu_si128((const __m128i *)(source + i));
+        const __m128i back = _mm_loadu_si128((const __m128i *)(source + j - sizeof(__m128i)));
+        _mm_storeu_si128((__m128i *)(destination + i), reverse_128(back));
+        _mm_storeu_si128((__m128i *)(destination + j - sizeof(__m128i)), reverse_128(front));
+    }
+#endif
+    for (; j - i >= 2 * sizeof(unsigned long long); i += sizeof(unsigned long long), j -= sizeof(unsigned long long)) {
+        unsigned long long front, back;
+        memcpy(&front, source + i, sizeof(front));
+        memcpy(&back, source + j - sizeof(back), sizeof(back));
+        back = __builtin_bswap64(back);
+        front = __builtin_bswap64(front);
+        memcpy(destination + i, &back, sizeof(back));
+        memcpy(destination + j - sizeof(front), &front, sizeof(front));
+    }
+    for (; j - i >= 2; ++i, --j) {
+        const char front = source[i];
+        destination[i] = source[j - 1];
+        destination[j - 1] = front;
+    }
+    if (j - i == 1) { // middle byte
+        destination[i] = source[i];
+    }
+}
+
+void string_reverse(string_t *const this) {
+    if (!this || this->size < 2) {
+        return;
+    }
+    if (this->size <= STRING_SMALL_SIZE_MAX) { // this string fits on stack
+        reverse_bytes(this->buffer, this->buffer, this->size);
+    } else { // this string neads heap
+        assert(this->control_block && this->control_block->capacity && string_control_block_owners(this->control_block));
+        if (!string_control_block_writable(this->control_block)) { // copy reversing on the way, at the exact size
+            string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), this->size + 1);
+            if (!control_block) {
+                return;
+            }
+            reverse_bytes(control_block->buffer, string_buffer(this), this->size);
+            string_control_block_release(this->control_block);
+            this->control_block = control_block;
+            this->offset = 0;
+        } else { // unique ownership
+            string_control_block_rebase(this);
+            reverse_bytes(this->control_block->buffer, this->control_block->buffer, this->size);
+        }
+        string_modified(this);
+    }
+}
+
+void string_utf8_reverse(string_t *const this) {
+    string_reverse(this);
+    if (!this || this->size < 2) {
+        return;
+    }
+    char *const buffer = string_unshare(this); // already unique after reversing
+    if (!buffer) {
+        return;
+    }
+    // reversed sequences read continuations then their lead, restoring their order
+    unsigned char *const data = (unsigned char *)buffer;
+    size_t i = 0;
+    while (i < this->size) {
+#ifdef __SSE2__
+        if (i + sizeof(__m128i) <= this->size) {
+            // continuation bytes, 0x80 to 0xBF, are the signed ones below -64
+            const __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+            const unsigned int continuations = (unsigned int)_mm_movemask_epi8(_mm_cmplt_epi8(block, _mm_set1_epi8(-64)));
+            if (!continuations) {
+                i += sizeof(__m128i);
+                continue;
+            }
+            i += (size_t)__builtin_ctz(continuations);
+        }
+#endif
+        if ((data[i] & 0xC0) != 0x80) {
+            ++i;
+            continue;
+        }
+        size_t lead = i + 1;
+        while (lead < this->size && lead - i < 3 && (data[lead] & 0xC0) == 0x80) {
+            ++lead;
+        }
+        if (lead < this->size && data[lead] >= 0xC0) { // a sequence, otherwise stray continuations stay reversed
+            unsigned char *const sequence = data + i;
+            const size_t last = lead - i;
+            const unsigned char first = sequence[0];
+            sequence[0] = sequence[last];
+            sequence[last] = first;
+            if (last == 3) {
+                const unsigned char second = sequence[1];
+                sequence[1] = sequence[2];
+                sequence[2] = second;
+            }
+            i = lead + 1;
+        } else {
+            i = lead;
+        }
+    }
+    string_modified(this);
+}
+
+void string_delete(string_t *const this) {
+    if (!this) {
+        return;
+    }
+    if (this->size > STRING_SMALL_SIZE_MAX) { // this string neads heap
+        assert(this->control_block && this->control_block->capacity && string_control_block_owners(this->control_block));
+        string_control_block_release(this->control_block);
+    }
+    this->size = 0;
+    this->buffer[0] = '\0';
+}
+
+void string_print(const string_t *const this) {
+    if (!this || !this->size) {
+        return;
+    }
+    if (this->size <= STRING_SMALL_SIZE_MAX) { // this string fits on stack
+        for (size_t i = 0; i < this->size; ++i) {
+            printf("%c", this->buffer[i]);
+        }
+    } else { // this string neads heap
+        for (size_t i = 0; i < this->size; ++i) {
+            printf("%c", string_buffer(this)[i]);
+        }
+    }
+}
+
+// appends count raw characters, growing the heap buffer geometrically
+static void string_append_characters(
+    string_t *const this,
+    const char *const characters,
+    const size_t count
+) {
+    const size_t size = this->size + count;
+    if (size <= STRING_SMALL_SIZE_MAX) { // new string fits on stack
+        memcpy(this->buffer + this->size, characters, count);
+    } else if (this->size <= STRING_SMALL_SIZE_MAX) { // this string fits on stack
+        string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), size << 1);
+        if (!control_block) {
+            return;
+        }
+        memcpy(control_block->buffer, this->buffer, this->size);
+        memcpy(control_block->buffer + this->size, characters, count);
+        this->control_block = control_block;
+        this->offset = 0;
+    } else if (!string_control_block_writable(this->control_block)) { // lazy copy
+        string_control_block_t *const control_block = string_control_block_init(string_arena_of(this), size << 1);
+        if (!control_block) {
+            return;
+        }
+        memcpy(control_block->buffer, string_buffer(this), this->size);
+        memcpy(control_block->buffer + this->size, characters, count);
+        string_control_block_release(this->control_block);
+        this->control_block = control_block;
+        this->offset = 0;
+    } else { // unique ownership
+        string_control_block_rebase(this);
+        // realloc, doubling the capacity in advance
+        if (this->control_block->capacity <= size && !string_control_block_resize(this, size << 1, size)) {
+            return;
+        }
+        memcpy(this->control_block->buffer + this->size, characters, count);
+    }
+    this->size = size;
+    string_modified(this);
+}
+
+static const char string_digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// writes the decimal digits ending right before end, two per division, returns the first one
+[[nodiscard]] static char *format_u64(char *end, unsigned long long value) {
+    while (value >= 100) {
+        const unsigned pair = (unsigned)(value % 100) << 1;
+        value /= 100;
+        end -= 2;
+        memcpy(end, string_digit_pairs + pair, 2);
+    }
+    if (value >= 10) {
+        end -= 2;
+        memcpy(end, string_digit_pairs + (value << 1), 2);
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+void string_append_u64(
+    string_t *const this,
+    const unsigned long long value
+) {
+    if (!this) {
+        return;
+    }
+    char digits[20];
+    char *const end = digits + sizeof(digits);
+    const char *const begin = format_u64(end, value);
+    string_append_characters(this, begin, end - begin);
+}
+
+void string_append_i64(
+    string_t *const this,
+    const long long value
+) {
+    if (!this) {
+        return;
+    }
+    char digits[21];
+    char *const end = digits + sizeof(digits);
+    char *begin = format_u64(end, value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value);
+    if (value < 0) {
+        *--begin = '-';
+    }
+    string_append_characters(this, begin, end - begin);
+}
+
+// %g style rendering of significant digits times 10^exponent, the first digit being the units one
+[[nodiscard]] static size_t format_general(
+    char *const output,
+    const char *const digits,
+    size_t count,
+    const int exponent
+) {
+    while (count > 1 && digits[count - 1] == '0') {
+        --count;
+    }
+    char *write = output;
+    if (exponent < -4 || exponent >= 16) { // scientific, fixed notation would exceed 17 digits
+        *write++ = digits[0];
+        if (count > 1) {
+            *write++ = '.';
+            memcpy(write, digits + 1, count - 1);
+            write += count - 1;
+        }
+        *write++ = 'e';
+        *write++ = exponent < 0 ? '-' : '+';
+        const unsigned magnitude = exponent < 0 ? -exponent : exponent;
+        if (magnitude < 10) {
+            *write++ = '0';
+        }
+        char exponent_digits[4];
+        char *const end = exponent_digits + sizeof(exponent_digits);
+        const char *const first = format_u64(end, magnitude);
+        memcpy(write, first, end - first);
+        write += end - first;
+    } else if (exponent < 0) { // 0.000ddd
+        *write++ = '0';
+        *write++ = '.';
+        for (int i = -1; i > exponent; --i) {
+            *write++ = '0';
+        }
+        memcpy(write, digits, count);
+        write += count;
+    } else { // ddd.ddd
+        const size_t units = (size_t)exponent + 1;
+        if (count <= units) {
+            memcpy(write, digits, count);
+            memset(write + count, '0', units - count);
+            write += units;
+        } else {
+            memcpy(write, digits, units);
+            write += units;
+            *write++ = '.';
+            memcpy(write, digits + units, count - units);
+            write += count - units;
+        }
+    }
+    return write - output;
+}
+
+static const double string_powers_of_ten[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define STRING_F64_EXACT_MAX 9007199254740992.0 // 2^53, integers up to it are exact doubles
+#define STRING_F64_FRACTION_DIGITS_MAX 17ul
+
+// shortest digits that read back as the same double
+void string_append_f64(
+    string_t *const this,
+    const double value
+) {
+    if (!this) {
+        return;
+    }
+    char characters[32];
+    const double magnitude = signbit(value) ? -value : value;
+    // m / 10^k is exact and correctly rounded for m < 2^53 and k <= 22, so it
+    // reads back as the same double, the least such k gives the shortest digits
+    for (size_t k = 0; magnitude < STRING_F64_EXACT_MAX && k <= STRING_F64_FRACTION_DIGITS_MAX; ++k) {
+        const double scaled = magnitude * string_powers_of_ten[k];
+        if (scaled >= STRING_F64_EXACT_MAX) {
+            break;
+        }
+        const unsigned long long mantissa = (unsigned long long)(scaled + 0.5);
+        if ((double)mantissa / string_powers_of_ten[k] != magnitude) {
+            continue;
+        }
+        char *const end = characters + sizeof(characters);
+        char *begin = format_u64(end, mantissa);
+        if (k) { // decimal point before the k fraction digits
+            while ((size_t)(end - begin) <= k) {
+                *--begin = '0';
+            }
+            memmove(begin - 1, begin, end - begin - k);
+            --begin;
+            end[-(long)k - 1] = '.';
+        }
+        if (signbit(value)) {
+            *--begin = '-';
+        }
+        string_append_characters(this, begin, end - begin);
+        return;
+    }
+    if (!isfinite(value)) {
+        const int length = snprintf(characters, sizeof(characters), "%g", value);
+        string_append_characters(this, characters, (size_t)length);
+        return;
+    }
+    // exponents and long fractions, rounding the 17 significant digits down to
+    // 15 and 16 while they still read back as the same double
+    char scientific[32];
+    snprintf(scientific, sizeof(scientific), "%.16e", magnitude); // d.dddddddddddddddde[+-]x
+    char digits[17];
+    digits[0] = scientific[0];
+    memcpy(digits + 1, scientific + 2, 16);
+    const int exponent = atoi(scientific + 19);
+    char *const begin = characters + signbit(value);
+    characters[0] = '-';
+    size_t length = 0;
+    for (size_t precision = 15; precision <= 17; ++precision) {
+        char rounded[17];
+        memcpy(rounded, digits, precision);
+        int rounded_exponent = exponent;
+        if (precision < 17 && digits[precision] >= '5') { // round half up, carrying through nines
+            size_t i = precision;
+            while (i && rounded[i - 1] == '9') {
+                rounded[--i] = '0';
+            }
+            if (i) {
+                ++rounded[i - 1];
+            } else {
+                rounded[0] = '1';
+                ++rounded_exponent;
+            }
+        }
+        length = format_general(begin, rounded, precision, rounded_exponent);
+        begin[length] = '\0';
+        if (precision == 17 || strtod(begin, NULL) == magnitude) {
+            break;
+        }
+    }
+    string_append_characters(this, characters, begin - characters + length);
+}
+
+// parses [+-]digits, returns the characters consumed, 0 if there is no number or it overflows
+[[nodiscard]] static size_t parse_u64(
+    const char *const characters,
+    const size_t count,
+    unsigned long long *const value
+) {
+    unsigned long long result = 0;
+    size_t i = 0;
+    for (; i < count && (unsigned char)(characters[i] - '0') < 10u; ++i) {
+        const unsigned digit = (unsigned char)(characters[i] - '0');
+        if (result > (ULLONG_MAX - digit) / 10) {
+            return 0;
+        }
+        result = result * 10 + digit;
+    }
+    if (i) {
+        *value = result;
+    }
+    return i;
+}
+
+// clips the range to the string, NULL if it is empty
+[[nodiscard]] static const char *string_range(
+    const string_t *const this,
+    const size_t index,
+    size_t *const count
+) {
+    if (!this || index >= this->size) {
+        return NULL;
+    }
+    if (*count > this->size - index) {
+        *count = this->size - index;
+    }
+    return *count ? string_buffer(this) + index : NULL;
+}
+
+[[nodiscard]] size_t string_parse_u64(
+    const string_t *const restrict this,
+    const size_t index,
+    size_t count,
+    unsigned long long *const restrict value
+) {
+    const char *const characters = string_range(this, index, &count);
+    if (!characters || !value) {
+        return 0;
+    }
+    const size_t sign = *characters == '+';
+    const size_t parsed = parse_u64(characters + sign, count - sign, value);
+    return parsed ? sign + parsed : 0;
+}
+
+[[nodiscard]] size_t string_parse_i64(
+    const string_t *const restrict this,
+    const size_t index,
+    size_t count,
+    long long *const restrict value
+) {
+    const char *const characters = string_range(this, index, &count);
+    if (!characters || !value) {
+        return 0;
+    }
+    const unsigned char negative = *characters == '-';
+    const size_t sign = negative || *characters == '+';
+    unsigned long long magnitude;
+    const size_t parsed = parse_u64(characters + sign, count - sign, &magnitude);
+    if (!parsed || magnitude > (unsigned long long)LLONG_MAX + negative) {
+        return 0;
+    }
+    *value = negative ? (long long)(0ull - magnitude) : (long long)magnitude;
+    return sign + parsed;
+}
+
+#define STRING_PARSE_F64_STACK 64ul
+
+// decimal notation [+-]digits[.digits][(e|E)[+-]digits]
+[[nodiscard]] size_t string_parse_f64(
+    const string_t *const restrict this,
+    const size_t index,
+    size_t count,
+    double *const restrict value
+) {
+    const char *const characters = string_range(this, index, &count);
+    if (!characters || !value) {
+        return 0;
+    }
+    size_t i = *characters == '-' || *characters == '+';
+    unsigned long long mantissa = 0;
+    size_t mantissa_digits = 0; // significant ones, leading zeros skipped
+    size_t digits = 0;
+    long long exponent = 0;
+    for (; i < count && (unsigned char)(characters[i] - '0') < 10u; ++i, ++digits) {
+        if (mantissa_digits < 19) {
+            mantissa = mantissa * 10 + (unsigned char)(characters[i] - '0');
+            mantissa_digits += mantissa != 0;
+        } else {
+            ++exponent; // dropped digit, parsed by strtod below
+            mantissa_digits = 20;
+        }
+    }
+    if (i < count && characters[i] == '.') {
+        for (++i; i < count && (unsigned char)(characters[i] - '0') < 10u; ++i, ++digits) {
+            if (mantissa_digits < 19) {
+                mantissa = mantissa * 10 + (unsigned char)(characters[i] - '0');
+                mantissa_digits += mantissa != 0;
+                --exponent;
+            } else {
+                mantissa_digits = 20;
+            }
+        }
+    }
+    if (!digits) {
+        return 0;
+    }
+    if (i + 1 < count && (characters[i] == 'e' || characters[i] == 'E')) {
+        size_t j = i + 1;
+        const unsigned char negative = characters[j] == '-';
+        j += negative || characters[j] == '+';
+        unsigned long long power;
+        const size_t parsed = parse_u64(characters + j, count - j, &power);
+        if (parsed) { // an exponent marker without digits is left unparsed
+            i = j + parsed;
+            exponent = power > 1000000 ? (negative ? -1000000 : 1000000) : exponent + (negative ? -(long long)power : (long long)power);
+        }
+    }
+    // exact for 53 bit mantissas and powers of ten up to 10^22 (Clinger fast path)
+    if (mantissa_digits <= 19 && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / string_powers_of_ten[-exponent] : result * string_powers_of_ten[exponent];
+        *value = *characters == '-' ? -result : result;
+        return i;
+    }
+    char stack_buffer[STRING_PARSE_F64_STACK];
+    char *const buffer = i < sizeof(stack_buffer) ? stack_buffer : malloc(i + 1);
+    if (!buffer) {
+        fprintf(stderr, "malloc NULL return in string_parse_f64 for size %lu\n", i + 1);
+        return 0;
+    }
+    memcpy(buffer, characters, i);
+    buffer[i] = '\0';
+    *value = strtod(buffer, NULL);
+    if (buffer != stack_buffer) {
+        free(buffer);
+    }
+    return i;
+}
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+// error classes of two consecutive bytes, looked up by the first byte nibbles and the second high one
+// (Keiser and Lemire, Validating UTF-8 In Less Than One Instruction Per Byte)
+#define UTF8_TOO_SHORT (1 << 0)
+#define UTF8_TOO_LONG (1 << 1)
+#define UTF8_OVERLONG_3 (1 << 2)
+#define UTF8_TOO_LARGE (1 << 3)
+#define UTF8_SURROGATE (1 << 4)
+#define UTF8_OVERLONG_2 (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)
+#define UTF8_TWO_CONTS (1 << 7)
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+#define UTF8_BYTE_1_HIGH \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, \
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2, \
+    UTF8_TOO_SHORT, \
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE, \
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+#define UTF8_BYTE_1_LOW \
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, \
+    UTF8_CARRY | UTF8_OVERLONG_2, \
+    UTF8_CARRY, \
+    UTF8_CARRY, \
+    UTF8_CARRY | UTF8_TOO_LARGE, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+#define UTF8_BYTE_2_HIGH \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+#endif
+
+#ifdef __AVX2__
+[[nodiscard]] static unsigned char utf8_validate(const unsigned char *const data, const size_t size) {
+    const __m256i byte_1_high_table = _mm256_setr_epi8(UTF8_BYTE_1_HIGH, UTF8_BYTE_1_HIGH);
+    const __m256i byte_1_low_table = _mm256_setr_epi8(UTF8_BYTE_1_LOW, UTF8_BYTE_1_LOW);
+    const __m256i byte_2_high_table = _mm256_setr_epi8(UTF8_BYTE_2_HIGH, UTF8_BYTE_2_HIGH);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    // a block ending inside a sequence needs its continuation bytes in the next block
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)0xEF, (char)0xDF, (char)0xBF
+    );
+    __m256i previous = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    for (size_t i = 0; i < size; i += sizeof(__m256i)) {
+        __m256i input;
+        if (i + sizeof(__m256i) <= size) {
+            input = _mm256_loadu_si256((const __m256i *)(data + i));
+        } else { // zero padded tail, NUL is ASCII
+            unsigned char tail[sizeof(__m256i)] = {0};
+            memcpy(tail, data + i, size - i);
+            input = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        if (!_mm256_movemask_epi8(input)) { // ASCII block
+            error = _mm256_or_si256(error, incomplete);
+            incomplete = _mm256_setzero_si256();
+            previous = input;
+            continue;
+        }
+        const __m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21); // previous high lane, input low lane
+        const __m256i previous_1 = _mm256_alignr_epi8(input, shifted, 15);
+        const __m256i previous_2 = _mm256_alignr_epi8(input, shifted, 14);
+        const __m256i previous_3 = _mm256_alignr_epi8(input, shifted, 13);
+        const __m256i special = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(previous_1, 4), nibble)),
+                _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(previous_1, nibble))
+            ),
+            _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble))
+        );
+        // third and fourth bytes of a sequence must be continuations, the only valid double continuation
+        const __m256i must_continue = _mm256_and_si256(
+            _mm256_or_si256(
+                _mm256_subs_epu8(previous_2, _mm256_set1_epi8(0xE0 - 0x80)),
+                _mm256_subs_epu8(previous_3, _mm256_set1_epi8((char)(0xF0 - 0x80)))
+            ),
+            _mm256_set1_epi8((char)0x80)
+        );
+        error = _mm256_or_si256(error, _mm256_xor_si256(must_continue, special));
+        incomplete = _mm256_subs_epu8(input, incomplete_max);
+        previous = input;
+    }
+    error = _mm256_or_si256(error, incomplete);
+    return _mm256_testz_si256(error, error);
+}
+#elif defined(__SSSE3__)
+[[nodiscard]] static unsigned char utf8_validate(const unsigned char *const data, const size_t size) {
+    const __m128i byte_1_high_table = _mm_setr_epi8(UTF8_BYTE_1_HIGH);
+    const __m128i byte_1_low_table = _mm_setr_epi8(UTF8_BYTE_1_LOW);
+    const __m128i byte_2_high_table = _mm_setr_epi8(UTF8_BYTE_2_HIGH);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    // a block ending inside a sequence needs its continuation bytes in the next block
+    const __m128i incomplete_max = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)0xEF, (char)0xDF, (char)0xBF
+    );
+    __m128i previous = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    for (size_t i = 0; i < size; i += sizeof(__m128i)) {
+        __m128i input;
+        if (i + sizeof(__m128i) <= size) {
+            input = _mm_loadu_si128((const __m128i *)(data + i));
+        } else { // zero padded tail, NUL is ASCII
+            unsigned char tail[sizeof(__m128i)] = {0};
+            memcpy(tail, data + i, size - i);
+            input = _mm_loadu_si128((const __m128i *)tail);
+        }
+        if (!_mm_movemask_epi8(input)) { // ASCII block
+            error = _mm_or_si128(error, incomplete);
+            incomplete = _mm_setzero_si128();
+            previous = input;
+            continue;
+        }
+        const __m128i previous_1 = _mm_alignr_epi8(input, previous, 15);
+        const __m128i previous_2 = _mm_alignr_epi8(input, previous, 14);
+        const __m128i previous_3 = _mm_alignr_epi8(input, previous, 13);
+        const __m128i special = _mm_and_si128(
+            _mm_and_si128(
+                _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(previous_1, 4), nibble)),
+                _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(previous_1, nibble))
+            ),
+            _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble))
+        );
+        // third and fourth bytes of a sequence must be continuations, the only valid double continuation
+        const __m128i must_continue = _mm_and_si128(
+            _mm_or_si128(
+                _mm_subs_epu8(previous_2, _mm_set1_epi8(0xE0 - 0x80)),
+                _mm_subs_epu8(previous_3, _mm_set1_epi8((char)(0xF0 - 0x80)))
+            ),
+            _mm_set1_epi8((char)0x80)
+        );
+        error = _mm_or_si128(error, _mm_xor_si128(must_continue, special));
+        incomplete = _mm_subs_epu8(input, incomplete_max);
+        previous = input;
+    }
+    error = _mm_or_si128(error, incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+#else
+// 8 byte ASCII words skipped at once
+[[nodiscard]] static unsigned char utf8_validate(const unsigned char *const data, const size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        unsigned long long word;
+        if (i + sizeof(word) <= size) {
+            memcpy(&word, data + i, sizeof(word));
+            if (!(word & 0x8080808080808080ull)) {
+                i += sizeof(word);
+                continue;
+            }
+        }
+        const unsigned char lead = data[i];
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        }
+        size_t length;
+        unsigned char min = 0x80, max = 0xBF; // second byte range, narrowed against overlongs, surrogates and > U+10FFFF
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            min = lead == 0xE0 ? 0xA0 : 0x80;
+            max = lead == 0xED ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            min = lead == 0xF0 ? 0x90 : 0x80;
+            max = lead == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return 0;
+        }
+        if (i + length > size || data[i + 1] < min || data[i + 1] > max) {
+            return 0;
+        }
+        for (size_t j = 2; j < length; ++j) {
+            if ((data[i + j] & 0xC0) != 0x80) {
+                return 0;
+            }
+        }
+        i += length;
+    }
+    return 1;
+}
+#endif
+
+[[nodiscard]] static inline unsigned char utf8_is_lead(const unsigned char c) {
+    return (c & 0xC0) != 0x80;
+}
+
+// code point leads (ASCII included) among the 16 bytes
+#ifdef __SSE2__
+[[nodiscard]] static inline unsigned int utf8_block_leads(const unsigned char *const block) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)block);
+    // continuation bytes are 0x80 to 0xBF, the signed ones up to -65
+    return (unsigned int)__builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(-65))));
+}
+#endif
+
+// byte offset of the code point count code points after the one at position, size if there are not as many
+[[nodiscard]] static size_t utf8_advance(
+    const unsigned char *const data,
+    const size_t size,
+    size_t position,
+    size_t count
+) {
+    if (position < size) { // the lead at position itself
+        ++count;
+    }
+#ifdef __SSE2__
+    for (; position + 16 <= size; position += 16) {
+        const unsigned int leads = utf8_block_leads(data + position);
+        if (leads >= count) {
+            break;
+        }
+        count -= leads;
+    }
+#endif
+    for (; position < size; ++position) {
+        if (utf8_is_lead(data[position]) && !--count) {
+            return position;
+        }
+    }
+    return size;
+}
+
+[[nodiscard]] unsigned char string_utf8_validate(const string_t *const this) {
+    if (!this) {
+        return 0;
+    }
+    return utf8_validate((const unsigned char *)string_buffer(this), this->size);
+}
+
+[[nodiscard]] size_t string_utf8_length(const string_t *const this) {
+    if (!this) {
+        return 0;
+    }
+    const unsigned char *const data = (const unsigned char *)string_buffer(this);
+    size_t length = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= this->size; i += 16) {
+        length += utf8_block_leads(data + i);
+    }
+#endif
+    for (; i < this->size; ++i) {
+        length += utf8_is_lead(data[i]);
+    }
+    return length;
+}
+
+[[nodiscard]] string_utf8_index_t string_utf8_index_init(const string_t *const this) {
+    string_utf8_index_t index = {
+        .offsets = NULL,
+        .length = 0
+    };
+    if (!this || !this->size) {
+        return index;
+    }
+    index.length = string_utf8_length(this);
+    const size_t samples = (index.length - 1) / STRING_UTF8_INDEX_STRIDE + 1;
+    index.offsets = malloc(samples * sizeof(size_t));
+    if (!index.offsets) {
+        fprintf(stderr, "malloc NULL return in string_utf8_index_init for %lu offsets\n", samples);
+        return index;
+    }
+    const unsigned char *const data = (const unsigned char *)string_buffer(this);
+    index.offsets[0] = utf8_advance(data, this->size, 0, 0);
+    for (size_t i = 1; i < samples; ++i) {
+        index.offsets[i] = utf8_advance(data, this->size, index.offsets[i - 1], STRING_UTF8_INDEX_STRIDE);
+    }
+    return index;
+}
+
+[[nodiscard]] size_t string_utf8_offset(
+    const string_t *const restrict this,
+    const string_utf8_index_t *const restrict index,
+    const size_t code_point
+) {
+    if (!this) {
+        return 0;
+    }
+    const unsigned char *const data = (const unsigned char *)string_buffer(this);
+    if (!index || !index->offsets) { // linear scan
+        return utf8_advance(data, this->size, 0, code_point);
+    }
+    if (code_point >= index->length) {
+        return this->size;
+    }
+    const size_t sample = code_point / STRING_UTF8_INDEX_STRIDE;
+    return utf8_advance(data, this->size, index->offsets[sample], code_point - sample * STRING_UTF8_INDEX_STRIDE);
+}
+
+void string_utf8_index_delete(string_utf8_index_t *const this) {
+    if (!this) {
+        return;
+    }
+    free(this->offsets);
+    this->offsets = NULL;
+    this->length = 0;
+}
+
+[[nodiscard]] string_view_t string_view(const string_t *const this) {
+    string_view_t view = {
+        .data = NULL,
+        .size = 0
+    };
+    if (!this) {
+        return view;
+    }
+    view.data = string_buffer(this);
+    view.size = this->size;
+    return view;
+}
+
+[[nodiscard]] string_view_t string_view_init(const char *const cstr) {
+    string_view_t view = {
+        .data = cstr,
+        .size = cstr ? strlen(cstr) : 0
+    };
+    return view;
+}
+
+[[nodiscard]] string_view_t string_view_slice(
+    const string_view_t this,
+    const size_t index,
+    size_t count
+) {
+    string_view_t slice = {
+        .data = NULL,
+        .size = 0
+    };
+    if (index >= this.size || !count) {
+        return slice;
+    }
+    if (count > this.size - index) {
+        count = this.size - index;
+    }
+    slice.data = this.data + index;
+    slice.size = count;
+    return slice;
+}
+
+[[nodiscard]] long long string_view_lfind(
+    const string_view_t this,
+    const string_view_t str,
+    const unsigned char case_insensitive
+) {
+    const size_t position = string_search(this.data, this.size, str.data, str.size, case_insensitive);
+    return position == STRING_NPOS ? -1 : (long long)position;
+}
+
+[[nodiscard]] long long string_view_rfind(
+    const string_view_t this,
+    const string_view_t str,
+    const unsigned char case_insensitive
+) {
+    const size_t position = string_rsearch(this.data, this.size, str.data, str.size, case_insensitive);
+    return position == STRING_NPOS ? -1 : (long long)position;
+}
+
+[[nodiscard]] long long string_view_compare(
+    const string_view_t this,
+    const string_view_t other,
+    const unsigned char case_insensitive
+) {
+    const long long size_diff = (long long)this.size - (long long)other.size;
+    if (size_diff) {
+        return size_diff;
+    }
+    return compare_string(this.data, other.data, this.size, case_insensitive);
+}
+
+// multiply and xorshift over 8 byte words
+[[nodiscard]] static size_t hash_bytes(const char *const data, const size_t size) {
+    unsigned long long hash = 0x9e3779b97f4a7c15ull ^ size;
+    size_t i = 0;
+    for (; i + sizeof(hash) <= size; i += sizeof(hash)) {
+        unsigned long long word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 29;
+    }
+    unsigned long long word = 0;
+    if (i < size) {
+        memcpy(&word, data + i, size - i);
+    }
+    hash = (hash ^ word) * 0x94d049bb133111ebull;
+    hash ^= hash >> 32;
+    return hash ? (size_t)hash : 1; // 0 marks a control block hash not computed yet
+}
+
+[[nodiscard]] size_t string_view_hash(const string_view_t this) {
+    return hash_bytes(this.data, this.size);
+}
+
+// computed once per control block and cached until the next edit, inline strings are hashed each time
+[[nodiscard]] size_t string_hash(const string_t *const this) {
+    if (!this) {
+        return 0;
+    }
+    if (this->size <= STRING_SMALL_SIZE_MAX) {
+        return hash_bytes(this->buffer, this->size);
+    }
+    string_control_block_t *const control_block = this->control_block;
+    // slices share the block with other characters, caching only for the string spanning all of it
+    const unsigned char spans_block = !this->offset && this->size == control_block->size;
+    if (spans_block) {
+#ifdef STRING_ATOMIC_REF_COUNTER
+        const size_t hash = atomic_load_explicit(&control_block->hash, memory_order_relaxed);
+#else
+        const size_t hash = control_block->hash;
+#endif
+        if (hash) {
+            return hash;
+        }
+    }
+    const size_t hash = hash_bytes(string_buffer(this), this->size);
+    if (spans_block) {
+#ifdef STRING_ATOMIC_REF_COUNTER
+        atomic_store_explicit(&control_block->hash, hash, memory_order_relaxed);
+#else
+        control_block->hash = hash;
+#endif
+    }
+    return hash;
+}
+
+[[nodiscard]] size_t hash_string(
+    const size_t m,
+    [[maybe_unused]] const size_t _,
+    const void *const key
+) {
+    assert(m != 0);
+#ifdef __SIZEOF_INT128__
+    // multiply and shift reduction, string_hash is mixed well enough to skip the modulo
+    return (size_t)(((unsigned __int128)string_hash(key) * m) >> 64);
+#else
+    return string_hash(key) % m;
+#endif
+}
+
+[[nodiscard]] signed char string_comparator(
+    const void *const this,
+    const void *const other
+) {
+    const string_t *const a = this;
+    const string_t *const b = other;
+    if (a->size != b->size) {
+        return a->size < b->size ? -1 : 1;
+    }
+    if (a->size > STRING_SMALL_SIZE_MAX) { // cached hashes settle most unequal heap strings without reading them
+        const size_t a_hash = string_hash(a);
+        const size_t b_hash = string_hash(b);
+        if (a_hash != b_hash) {
+            return a_hash < b_hash ? -1 : 1;
+        }
+        if (a->control_block == b->control_block && a->offset == b->offset) {
+            return 0;
+        }
+    }
+    const int result = memcmp(string_buffer(a), string_buffer(b), a->size);
+    return (signed char)((result > 0) - (result < 0));
+}
+
+[[nodiscard]] string_tokenizer_t string_tokenizer_init(
+    const string_view_t view,
+    const char *const delimiters
+) {
+    string_tokenizer_t this = {
+        .view = view,
+        .position = 0,
+        .block = STRING_NPOS,
+        .bits = 0,
+        .ascii = 1,
+        .list_size = 0
+    };
+    memset(this.delimiters, 0, sizeof(this.delimiters));
+    memset(this.low_nibbles, 0, sizeof(this.low_nibbles));
+    memset(this.high_nibbles, 0, sizeof(this.high_nibbles));
+    for (unsigned char h = 0; h < 8; ++h) {
+        this.high_nibbles[h] = 1u << h;
+    }
+    if (!delimiters) {
+        return this;
+    }
+    for (const unsigned char *d = (const unsigned char *)delimiters; *d; ++d) {
+        if (this.delimiters[*d]) {
+            continue;
+        }
+        this.delimiters[*d] = 1;
+        if (*d >= 0x80) {
+            this.ascii = 0;
+        } else {
+            this.low_nibbles[*d & 0x0f] |= 1u << (*d >> 4);
+        }
+        if (this.list_size < STRING_TOKENIZER_LIST_CAPACITY) {
+            this.list[this.list_size] = (char)*d;
+        }
+        ++this.list_size;
+    }
+    return this;
+}
+
+// delimiter bit per byte of the 64 bytes from block, bytes past the view count as delimiters
+[[nodiscard]] static unsigned long long string_tokenizer_classify(
+    const string_tokenizer_t *const this,
+    const size_t block
+) {
+    const unsigned char *const data = (const unsigned char *)this->view.data + block;
+    unsigned long long bits = 0;
+    size_t i = 0;
+    if (block + 64 <= this->view.size) {
+#ifdef __SSSE3__
+        if (this->ascii) { // nibble lookup
+            const __m128i low_nibbles = _mm_loadu_si128((const __m128i *)this->low_nibbles);
+            const __m128i high_nibbles = _mm_loadu_si128((const __m128i *)this->high_nibbles);
+            const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+            for (; i < 64; i += 16) {
+                const __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+                const __m128i low = _mm_shuffle_epi8(low_nibbles, _mm_and_si128(bytes, nibble_mask));
+                const __m128i high = _mm_shuffle_epi8(high_nibbles, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask));
+                const unsigned int others = (unsigned int)_mm_movemask_epi8(
+                    _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128())
+                );
+                bits |= (unsigned long long)(others ^ 0xffffu) << i;
+            }
+            return bits;
+        }
+#endif
+#ifdef __SSE2__
+        if (this->list_size <= STRING_TOKENIZER_LIST_CAPACITY) { // direct comparisons
+            for (; i < 64; i += 16) {
+                const __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+                __m128i matches = _mm_setzero_si128();
+                for (unsigned char d = 0; d < this->list_size; ++d) {
+                    matches = _mm_or_si128(matches, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(this->list[d])));
+                }
+                bits |= (unsigned long long)(unsigned int)_mm_movemask_epi8(matches) << i;
+            }
+            return bits;
+        }
+#endif
+    }
+    for (; i < 64; ++i) {
+        if (block + i >= this->view.size || this->delimiters[data[i]]) {
+            bits |= 1ull << i;
+        }
+    }
+    return bits;
+}
+
+// first position from the given one with delimiters class equal to delimiter
+[[nodiscard]] static size_t string_tokenizer_scan(
+    string_tokenizer_t *const this,
+    size_t position,
+    const unsigned char delimiter
+) {
+    while (position < this->view.size) {
+        const size_t block = position & ~(size_t)63;
+        if (block != this->block) {
+            this->bits = string_tokenizer_classify(this, block);
+            this->block = block;
+        }
+        const unsigned long long found = (delimiter ? this->bits : ~this->bits) >> (position - block);
+        if (found) {
+            position += (size_t)__builtin_ctzll(found);
+            return position < this->view.size ? position : this->view.size;
+        }
+        position = block + 64;
+    }
+    return this->view.size;
+}
+
+[[nodiscard]] unsigned char string_tokenizer_next(
+    string_tokenizer_t *const restrict this,
+    string_span_t *const restrict span
+) {
+    if (!this || !span) {
+        return 0;
+    }
+    const size_t start = string_tokenizer_scan(this, this->position, 0);
+    if (start == this->view.size) {
+        this->position = start;
+        return 0;
+    }
+    const size_t end = string_tokenizer_scan(this, start + 1, 1);
+    span->offset = start;
+    span->size = end - start;
+    this->position = end;
+    return 1;
+}
+
+[[nodiscard]] size_t string_split(
+    const string_t *const restrict this,
+    const char *const restrict delimiters,
+    string_span_t *const restrict spans,
+    const size_t max
+) {
+    if (!this || !spans) {
+        return 0;
+    }
+    string_tokenizer_t tokenizer = string_tokenizer_init(string_view(this), delimiters);
+    size_t count = 0;
+    while (count < max && string_tokenizer_next(&tokenizer, spans + count)) {
+        ++count;
+    }
+    return count;
+}
+
+[[nodiscard]] string_arena_t *string_arena_init(const size_t capacity) {
+    string_arena_t *const sa = malloc(sizeof(string_arena_t));
+    if (!sa) {
+        fprintf(stderr, "malloc NULL return in string_arena_init\n");
+        return NULL;
+    }
+    sa->head = NULL;
+    sa->chunk_capacity = capacity < STRING_ARENA_CHUNK_MIN ? STRING_ARENA_CHUNK_MIN : capacity;
+    sa->size = 0;
+    return sa;
+}
+
+[[nodiscard]] size_t string_arena_size(const string_arena_t *const this) {
+    if (!this) {
+        return 0;
+    }
+    return this->size;
+}
+
+void string_arena_reset(string_arena_t *const this) {
+    if (!this || !this->head) {
+        return;
+    }
+    // the head chunk is kept for the next strings, the largest regular one
+    string_arena_chunk_t *chunk = this->head->next;
+    while (chunk) {
+        string_arena_chunk_t *const next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    this->head->next = NULL;
+    this->head->used = 0;
+    this->size = 0;
+}
+
+void string_arena_delete(string_arena_t *const this) {
+    if (!this) {
+        return;
+    }
+    string_arena_chunk_t *chunk = this->head;
+    while (chunk) {
+        string_arena_chunk_t *const next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(this);
+}
+
+struct string_builder_chunk {
+    string_builder_chunk_t *next;
+    size_t begin; // prepended chunks are filled from their end
+    size_t end;
+    size_t capacity;
+    char buffer[];
+};
+
+[[nodiscard]] string_builder_t string_builder_init(const size_t capacity) {
+    string_builder_t this = {
+        .head = NULL,
+        .tail = NULL,
+        .size = 0,
+        .chunk_capacity = capacity < STRING_BUILDER_CHUNK_MIN ? STRING_BUILDER_CHUNK_MIN : capacity
+    };
+    return this;
+}
+
+[[nodiscard]] size_t string_builder_length(const string_builder_t *const this) {
+    if (!this) {
+        return 0;
+    }
+    return this->size;
+}
+
+[[nodiscard]] static string_builder_chunk_t *string_builder_chunk_init(
+    string_builder_t *const this,
+    const size_t size
+) {
+    const size_t capacity = size > this->chunk_capacity ? size : this->chunk_capacity;
+    string_builder_chunk_t *const chunk = malloc(sizeof(string_builder_chunk_t) + capacity);
+    if (!chunk) {
+        fprintf(stderr, "malloc NULL return in string_builder_chunk_init for capacity %lu\n", capacity);
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    if (this->chunk_capacity < STRING_BUILDER_CHUNK_MAX) {
+        this->chunk_capacity <<= 1;
+    }
+    return chunk;
+}
+
+void string_builder_append(
+    string_builder_t *const this,
+    const string_view_t str
+) {
+    if (!this || !str.size) {
+        return;
+    }
+    string_builder_chunk_t *chunk = this->tail;
+    size_t copied = 0;
+    if (chunk) { // filling the last chunk first
+        copied = chunk->capacity - chunk->end < str.size ? chunk->capacity - chunk->end : str.size;
+        memcpy(chunk->buffer + chunk->end, str.data, copied);
+        chunk->end += copied;
+    }
+    if (copied < str.size) {
+        string_builder_chunk_t *const next = string_builder_chunk_init(this, str.size - copied);
+        if (!next) {
+            if (chunk) {
+                chunk->end -= copied;
+            }
+            return;
+        }
+        next->begin = 0;
+        next->end = str.size - copied;
+        memcpy(next->buffer, str.data + copied, next->end);
+        if (chunk) {
+            chunk->next = next;
+        } else {
+            this->head = next;
+        }
+        this->tail = next;
+    }
+    this->size += str.size;
+}
+
+void string_builder_prepend(
+    string_builder_t *const this,
+    const string_view_t str
+) {
+    if (!this || !str.size) {
+        return;
+    }
+    string_builder_chunk_t *chunk = this->head;
+    size_t copied = 0;
+    if (chunk) { // filling the first chunk free space first
+        copied = chunk->begin < str.size ? chunk->begin : str.size;
+        chunk->begin -= copied;
+        memcpy(chunk->buffer + chunk->begin, str.data + str.size - copied, copied);
+    }
+    if (copied < str.size) {
+        string_builder_chunk_t *const previous = string_builder_chunk_init(this, str.size - copied);
+        if (!previous) {
+            if (chunk) {
+                chunk->begin += copied;
+            }
+            return;
+        }
+        previous->end = previous->capacity;
+        previous->begin = previous->end - (str.size - copied);
+        memcpy(previous->buffer + previous->begin, str.data, str.size - copied);
+        previous->next = chunk;
+        if (!chunk) {
+            this->tail = previous;
+        }
+        this->head = previous;
+    }
+    this->size += str.size;
+}
+
+void string_builder_append_char(
+    string_builder_t *const this,
+    const char c
+) {
+    if (!this) {
+        return;
+    }
+    string_builder_chunk_t *const chunk = this->tail;
+    if (chunk && chunk->end < chunk->capacity) {
+        chunk->buffer[chunk->end++] = c;
+        ++this->size;
+        return;
+    }
+    const string_view_t str = {
+        .data = &c,
+        .size = 1
+    };
+    string_builder_append(this, str);
+}
+
+[[nodiscard]] string_t string_builder_build(const string_builder_t *const this) {
+    string_t built = {
+        .size = 0,
+        .control_block = NULL
+    };
+    if (!this || !this->size) {
+        return built;
+    }
+    char *buffer = string_prepare(&built, NULL, this->size, this->size + 1);
+    if (!buffer) {
+        return built;
+    }
+    for (const string_builder_chunk_t *chunk = this->head; chunk; chunk = chunk->next) {
+        memcpy(buffer, chunk->buffer + chunk->begin, chunk->end - chunk->begin);
+        buffer += chunk->end - chunk->begin;
+    }
+    return built;
+}
+
+void string_builder_clear(string_builder_t *const this) {
+    if (!this) {
+        return;
+    }
+    for (string_builder_chunk_t *chunk = this->head; chunk; ) {
+        string_builder_chunk_t *const next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    this->head = NULL;
+    this->tail = NULL;
+    this->size = 0;
+}
+
+void string_builder_delete(string_builder_t *const this) {
+    string_builder_clear(this);
+}
@@ -0,0 +1,246 @@
+#include "string_matcher.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STRING_MATCHER_NONE UINT_MAX
+
+// Aho-Corasick automaton with every failure transition resolved into a dense table,
+// bytes not occurring in any pattern share class 0 so rows stay short
+struct string_matcher {
+    unsigned int *transitions; // rows of class_count entries holding the next state row offset
+    unsigned int matching; // row offset of the first state with matches, they are numbered last
+    unsigned int *patterns; // first pattern ending in each state
+    unsigned int *next_patterns; // next pattern ending in the same state
+    unsigned int *suffixes; // longest proper suffix state with patterns
+    size_t *lengths;
+    size_t pattern_count;
+    size_t state_count;
+    size_t class_count;
+    unsigned char classes[256];
+};
+
+[[nodiscard]] static inline unsigned char fold_byte(const unsigned char c, const unsigned char case_insensitive) {
+    return case_insensitive && (unsigned char)(c - 'A') < 26u ? c | 0x20 : c;
+}
+
+void string_matcher_delete(string_matcher_t *const this) {
+    if (this == NULL) {
+        return;
+    }
+    free(this->transitions);
+    free(this->patterns);
+    free(this->next_patterns);
+    free(this->suffixes);
+    free(this->lengths);
+    free(this);
+}
+
+[[nodiscard]] string_matcher_t *string_matcher_init(
+    const char *const *const patterns,
+    const size_t count,
+    const unsigned char case_insensitive
+) {
+    if (patterns == NULL || count >= STRING_MATCHER_NONE) {
+        return NULL;
+    }
+    string_matcher_t *const sm = calloc(1, sizeof(string_matcher_t));
+    if (sm == NULL) {
+        fprintf(stderr, "malloc NULL return in string_matcher_init\n");
+        return NULL;
+    }
+    sm->pattern_count = count;
+    sm->lengths = malloc((count ? count : 1) * sizeof(size_t));
+    sm->next_patterns = malloc((count ? count : 1) * sizeof(unsigned int));
+    if (sm->lengths == NULL || sm->next_patterns == NULL) {
+        fprintf(stderr, "malloc NULL return in string_matcher_init for %lu patterns\n", count);
+        string_matcher_delete(sm);
+        return NULL;
+    }
+    // byte classes, case folded letters sharing one
+    size_t max_states = 1;
+    unsigned char used[256] = {0};
+    for (size_t i = 0; i < count; ++i) {
+        sm->lengths[i] = patterns[i] ? strlen(patterns[i]) : 0;
+        max_states += sm->lengths[i];
+        for (size_t j = 0; j < sm->lengths[i]; ++j) {
+            used[fold_byte((unsigned char)patterns[i][j], case_insensitive)] = 1;
+        }
+    }
+    sm->class_count = 1;
+    for (size_t c = 0; c < 256; ++c) {
+        sm->classes[c] = used[c] ? (unsigned char)sm->class_count++ : 0;
+    }
+    if (case_insensitive) {
+        for (size_t c = 'A'; c <= 'Z'; ++c) {
+            sm->classes[c] = sm->classes[c | 0x20];
+        }
+    }
+    if (max_states > STRING_MATCHER_NONE >> 1 || max_states * sm->class_count > STRING_MATCHER_NONE >> 1) {
+        fprintf(stderr, "string_matcher_init: %lu states exceed the transition table range\n", max_states);
+        string_matcher_delete(sm);
+        return NULL;
+    }
+    sm->transitions = malloc(max_states * sm->class_count * sizeof(unsigned int));
+    sm->patterns = malloc(max_states * sizeof(unsigned int));
+    sm->suffixes = malloc(max_states * sizeof(unsigned int));
+    unsigned int *const failures = malloc(max_states * sizeof(unsigned int));
+    unsigned int *const queue = malloc(max_states * sizeof(unsigned int));
+    if (sm->transitions == NULL || sm->patterns == NULL || sm->suffixes == NULL || failures == NULL || queue == NULL) {
+        fprintf(stderr, "malloc NULL return in string_matcher_init for %lu states\n", max_states);
+        free(failures);
+        free(queue);
+        string_matcher_delete(sm);
+        return NULL;
+    }
+    const size_t class_count = sm->class_count;
+    unsigned int *const transitions = sm->transitions;
+    // trie of the patterns
+    memset(transitions, 0xFF, class_count * sizeof(unsigned int));
+    sm->patterns[0] = STRING_MATCHER_NONE;
+    size_t state_count = 1;
+    for (size_t i = 0; i < count; ++i) {
+        sm->next_patterns[i] = STRING_MATCHER_NONE;
+        if (!sm->lengths[i]) {
+            continue;
+        }
+        size_t state = 0;
+        for (size_t j = 0; j < sm->lengths[i]; ++j) {
+            unsigned int *const next = transitions + state * class_count + sm->classes[(unsigned char)patterns[i][j]];
+            if (*next == STRING_MATCHER_NONE) {
+                memset(transitions + state_count * class_count, 0xFF, class_count * sizeof(unsigned int));
+                sm->patterns[state_count] = STRING_MATCHER_NONE;
+                *next = (unsigned int)state_count++;
+            }
+            state = *next;
+        }
+        sm->next_patterns[i] = sm->patterns[state];
+        sm->patterns[state] = (unsigned int)i;
+    }
+    // breadth first failure links, missing transitions resolved through them
+    size_t head = 0, tail = 0;
+    failures[0] = 0;
+    for (size_t c = 0; c < class_count; ++c) {
+        unsigned int *const next = transitions + c;
+        if (*next == STRING_MATCHER_NONE) {
+            *next = 0;
+        } else {
+            failures[*next] = 0;
+            queue[tail++] = *next;
+        }
+    }
+    while (head < tail) {
+        const size_t state = queue[head++];
+        for (size_t c = 0; c < class_count; ++c) {
+            unsigned int *const next = transitions + state * class_count + c;
+            const unsigned int fallback = transitions[failures[state] * class_count + c];
+            if (*next == STRING_MATCHER_NONE) {
+                *next = fallback;
+            } else {
+                failures[*next] = fallback;
+                queue[tail++] = *next;
+            }
+        }
+    }
+    // nearest suffix states with patterns, failures come earlier in the queue
+    sm->suffixes[0] = STRING_MATCHER_NONE;
+    for (size_t i = 0; i < tail; ++i) {
+        const unsigned int failure = failures[queue[i]];
+        sm->suffixes[queue[i]] = sm->patterns[failure] != STRING_MATCHER_NONE ? failure : sm->suffixes[failure];
+    }
+    // renumbering states with matches last, so one compare per byte tells if any pattern ends there
+    unsigned int *const numbers = failures;
+    size_t number = 0;
+    for (unsigned char with_matches = 0; with_matches < 2; ++with_matches) {
+        if (with_matches) {
+            sm->matching = (unsigned int)(number * class_count);
+        }
+        for (size_t state = 0; state < state_count; ++state) {
+            if ((sm->patterns[state] != STRING_MATCHER_NONE || sm->suffixes[state] != STRING_MATCHER_NONE) == with_matches) {
+                numbers[state] = (unsigned int)number++;
+            }
+        }
+    }
+    unsigned int *const renumbered = malloc(state_count * class_count * sizeof(unsigned int));
+    if (renumbered == NULL) {
+        fprintf(stderr, "malloc NULL return in string_matcher_init for %lu states\n", state_count);
+        free(failures);
+        free(queue);
+        string_matcher_delete(sm);
+        return NULL;
+    }
+    for (size_t state = 0; state < state_count; ++state) { // premultiplied row offsets
+        const unsigned int *const row = transitions + state * class_count;
+        unsigned int *const renumbered_row = renumbered + numbers[state] * class_count;
+        for (size_t c = 0; c < class_count; ++c) {
+            renumbered_row[c] = (unsigned int)(numbers[row[c]] * class_count);
+        }
+        queue[numbers[state]] = sm->patterns[state];
+    }
+    memcpy(sm->patterns, queue, state_count * sizeof(unsigned int));
+    for (size_t state = 0; state < state_count; ++state) {
+        const unsigned int suffix = sm->suffixes[state];
+        queue[numbers[state]] = suffix == STRING_MATCHER_NONE ? suffix : numbers[suffix];
+    }
+    memcpy(sm->suffixes, queue, state_count * sizeof(unsigned int));
+    free(failures);
+    free(queue);
+    free(sm->transitions);
+    sm->transitions = renumbered;
+    sm->state_count = state_count;
+    return sm;
+}
+
+[[nodiscard]] size_t string_matcher_states(const string_matcher_t *const this) {
+    return this == NULL ? 0 : this->state_count;
+}
+
+[[nodiscard]] size_t string_matcher_view_find(
+    const string_matcher_t *const restrict this,
+    const string_view_t text,
+    string_match_t *const restrict matches,
+    const size_t max
+) {
+    if (this == NULL || text.data == NULL) {
+        return 0;
+    }
+    const unsigned int *const transitions = this->transitions;
+    const unsigned char *const classes = this->classes;
+    const unsigned char *const data = (const unsigned char *)text.data;
+    size_t found = 0;
+    const unsigned int matching = this->matching;
+    unsigned int row = 0;
+    for (size_t i = 0; i < text.size; ++i) {
+        row = transitions[row + classes[data[i]]];
+        if (row < matching) {
+            continue;
+        }
+        // patterns ending here, this state first, then its suffix states
+        unsigned int state = (unsigned int)(row / this->class_count);
+        if (this->patterns[state] == STRING_MATCHER_NONE) {
+            state = this->suffixes[state];
+        }
+        for (; state != STRING_MATCHER_NONE; state = this->suffixes[state]) {
+            for (unsigned int p = this->patterns[state]; p != STRING_MATCHER_NONE; p = this->next_patterns[p]) {
+                if (found < max && matches != NULL) {
+                    matches[found].pattern = p;
+                    matches[found].offset = i + 1 - this->lengths[p];
+                }
+                ++found;
+            }
+        }
+    }
+    return found;
+}
+
+[[nodiscard]] size_t string_matcher_find(
+    const string_matcher_t *const restrict this,
+    const string_t *const restrict string,
+    string_match_t *const restrict matches,
+    const size_t max
+) {
+    if (string == NULL) {
+        return 0;
+    }
+    return string_matcher_view_find(this, string_view(string), matches, max);
+}
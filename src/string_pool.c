@@ -0,0 +1,207 @@
+#include "string_pool.h"
+#include "hash_map_typed.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct string_pool_key string_pool_key_t;
+
+struct string_pool_key {
+    size_t hash;
+    string_view_t view; // interned characters for stored keys
+};
+
+[[nodiscard]] static inline size_t string_pool_key_hash(const string_pool_key_t key) {
+    return key.hash;
+}
+
+[[nodiscard]] static inline unsigned char string_pool_key_equal(
+    const string_pool_key_t a,
+    const string_pool_key_t b
+) {
+    return a.hash == b.hash && a.view.size == b.view.size && !memcmp(a.view.data, b.view.data, a.view.size);
+}
+
+HASH_MAP_DEFINE(string_pool_map, string_pool_key_t, string_interned_t *, string_pool_key_hash, string_pool_key_equal)
+
+struct string_pool {
+    string_pool_map_t *map;
+    pthread_rwlock_t lock;
+    unsigned char thread_safe;
+    size_t bytes;
+    size_t characters;
+    atomic_size_t references;
+    atomic_size_t referenced_bytes;
+};
+
+[[nodiscard]] string_pool_t *string_pool_init(const size_t capacity, const unsigned char thread_safe) {
+    string_pool_t *const sp = malloc(sizeof(string_pool_t));
+    if (sp == NULL) {
+        fprintf(stderr, "malloc NULL return in string_pool_init\n");
+        return sp;
+    }
+    sp->map = string_pool_map_init(capacity);
+    if (sp->map == NULL) {
+        free(sp);
+        return NULL;
+    }
+    if (thread_safe && pthread_rwlock_init(&sp->lock, NULL)) {
+        fprintf(stderr, "pthread_rwlock_init failure in string_pool_init\n");
+        string_pool_map_delete(sp->map);
+        free(sp);
+        return NULL;
+    }
+    sp->thread_safe = thread_safe;
+    sp->bytes = 0;
+    sp->characters = 0;
+    atomic_init(&sp->references, 0);
+    atomic_init(&sp->referenced_bytes, 0);
+    return sp;
+}
+
+[[nodiscard]] size_t string_pool_size(const string_pool_t *const this) {
+    return this == NULL ? 0 : string_pool_map_size(this->map);
+}
+
+[[nodiscard]] static string_interned_t *string_pool_lookup(
+    string_pool_t *const this,
+    const string_pool_key_t key
+) {
+    if (this->thread_safe) {
+        pthread_rwlock_rdlock(&this->lock);
+    }
+    string_interned_t **const found = string_pool_map_at(this->map, key);
+    string_interned_t *const interned = found ? *found : NULL;
+    if (this->thread_safe) {
+        pthread_rwlock_unlock(&this->lock);
+    }
+    return interned;
+}
+
+[[nodiscard]] const string_interned_t *string_pool_find(
+    string_pool_t *const this,
+    const string_view_t str
+) {
+    if (this == NULL || (str.data == NULL && str.size)) {
+        return NULL;
+    }
+    const string_pool_key_t key = {
+        .hash = string_view_hash(str),
+        .view = str
+    };
+    return string_pool_lookup(this, key);
+}
+
+[[nodiscard]] const string_interned_t *string_pool_intern(
+    string_pool_t *const this,
+    const string_view_t str
+) {
+    if (this == NULL || (str.data == NULL && str.size)) {
+        return NULL;
+    }
+    string_pool_key_t key = {
+        .hash = string_view_hash(str),
+        .view = str
+    };
+    atomic_fetch_add_explicit(&this->references, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&this->referenced_bytes, str.size, memory_order_relaxed);
+    string_interned_t *interned = string_pool_lookup(this, key);
+    if (interned) {
+        return interned;
+    }
+    if (this->thread_safe) {
+        pthread_rwlock_wrlock(&this->lock);
+    }
+    string_interned_t **const found = string_pool_map_at(this->map, key); // interned by another thread meanwhile
+    if (found) {
+        interned = *found;
+    } else {
+        interned = malloc(sizeof(string_interned_t) + str.size + 1);
+        if (interned == NULL) {
+            fprintf(stderr, "malloc NULL return in string_pool_intern for size %lu\n", str.size);
+        } else {
+            interned->hash = key.hash;
+            interned->size = str.size;
+            if (str.size) {
+                memcpy(interned->data, str.data, str.size);
+            }
+            interned->data[str.size] = '\0';
+            key.view.data = interned->data;
+            const size_t size = string_pool_map_size(this->map);
+            string_pool_map_insert(this->map, key, interned);
+            if (string_pool_map_size(this->map) == size) { // insertion failure
+                free(interned);
+                interned = NULL;
+            } else {
+                this->bytes += sizeof(string_interned_t) + str.size + 1;
+                this->characters += str.size;
+            }
+        }
+    }
+    if (this->thread_safe) {
+        pthread_rwlock_unlock(&this->lock);
+    }
+    return interned;
+}
+
+[[nodiscard]] const string_interned_t *string_pool_intern_cstr(
+    string_pool_t *const this,
+    const char *const cstr
+) {
+    if (cstr == NULL) {
+        return NULL;
+    }
+    return string_pool_intern(this, string_view_init(cstr));
+}
+
+[[nodiscard]] const string_interned_t *string_pool_intern_string(
+    string_pool_t *const this,
+    const string_t *const str
+) {
+    if (str == NULL) {
+        return NULL;
+    }
+    return string_pool_intern(this, string_view(str));
+}
+
+[[nodiscard]] string_pool_stats_t string_pool_stats(const string_pool_t *const this) {
+    string_pool_stats_t stats = {
+        .strings = 0,
+        .references = 0,
+        .bytes = 0,
+        .saved_bytes = 0
+    };
+    if (this == NULL) {
+        return stats;
+    }
+    string_pool_t *const pool = (string_pool_t *)this;
+    if (pool->thread_safe) {
+        pthread_rwlock_rdlock(&pool->lock);
+    }
+    stats.strings = string_pool_map_size(pool->map);
+    stats.bytes = pool->bytes;
+    const size_t characters = pool->characters;
+    if (pool->thread_safe) {
+        pthread_rwlock_unlock(&pool->lock);
+    }
+    stats.references = atomic_load_explicit(&pool->references, memory_order_relaxed);
+    const size_t referenced_bytes = atomic_load_explicit(&pool->referenced_bytes, memory_order_relaxed);
+    stats.saved_bytes = referenced_bytes > characters ? referenced_bytes - characters : 0;
+    return stats;
+}
+
+void string_pool_delete(string_pool_t *const this) {
+    if (this == NULL) {
+        return;
+    }
+    size_t cursor = 0;
+    for (string_pool_map_bucket_t *b; (b = string_pool_map_iterate(this->map, &cursor)); ) {
+        free(b->data);
+    }
+    string_pool_map_delete(this->map);
+    if (this->thread_safe) {
+        pthread_rwlock_destroy(&this->lock);
+    }
+    free(this);
+}